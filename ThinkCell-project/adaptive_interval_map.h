@@ -0,0 +1,234 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "append_interval_map.h"
+#include "frozen_interval_map.h"
+#include "interval_map.h"
+
+
+enum class adaptive_backend
+{
+    tree,       // interval_map
+    flat,       // append_interval_map, a sorted deque
+    frozen      // frozen_interval_map, read-only
+};
+
+
+/*
+    interval_map that picks its representation from the workload it observes.
+
+    Every window of operations it counts lookups, assigns at the tail (keyBegin not below the last
+    boundary) and other assigns, and estimates what the window would have cost on each backend:
+
+        tree     lookup 3 log n, assign 4 log n
+        flat     lookup log n, tail assign log n, other assign log n + n / 8 for the moved entries
+        frozen   lookup 0.7 log n, cannot assign
+
+    The units are rough cache-miss equivalents, not measurements. It switches when another backend
+    was estimated at least a quarter cheaper in two windows in a row and the saving over switchPayback
+    windows covers the 2n cost of rebuilding, so a mixed workload does not make it oscillate.
+    An assign on the frozen backend switches to the tree right away.
+
+    Lookups only bump a relaxed atomic counter, so const use can be shared between threads like
+    for any other map. The windows are closed, and the representation switched, only by assign()
+    and adapt(); a read-only workload has to call adapt() now and then to reach the frozen backend.
+    A reference returned by operator[] is valid until the next assign() or adapt().
+*/
+template<typename K, typename V>
+class adaptive_interval_map
+{
+public:
+    explicit adaptive_interval_map(const V &value, std::size_t window = 1024)
+        : m_impl(std::in_place_type<interval_map<K, V>>, value)
+        , m_window(window == 0 ? 1 : window)
+    { }
+
+    adaptive_interval_map(const adaptive_interval_map &other)
+        : m_impl(other.m_impl)
+        , m_backend(other.m_backend)
+        , m_candidate(other.m_candidate)
+        , m_candidateWindows(other.m_candidateWindows)
+        , m_switchCount(other.m_switchCount)
+        , m_window(other.m_window)
+        , m_assigns(other.m_assigns)
+        , m_tailAssigns(other.m_tailAssigns)
+        , m_lookups(other.m_lookups.load(std::memory_order_relaxed))
+    { }
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        if (m_backend == adaptive_backend::frozen)
+        {
+            switchTo(adaptive_backend::tree);
+        }
+        if (const auto *flat = std::get_if<append_interval_map<K, V>>(&m_impl))
+        {
+            m_tailAssigns += flat->size() == 0 || !(keyBegin < std::prev(flat->end())->first);
+        }
+        else
+        {
+            const auto &tree = std::get<interval_map<K, V>>(m_impl);
+            m_tailAssigns += tree.empty() || !(keyBegin < std::prev(tree.end())->first);
+        }
+        m_assigns++;
+        std::visit([&](auto &impl)
+        {
+            if constexpr (!std::is_same_v<std::decay_t<decltype(impl)>, frozen_interval_map<K, V>>)
+            {
+                impl.assign(keyBegin, keyEnd, val);
+            }
+        }, m_impl);
+        adapt();
+    }
+
+    const V &operator[](const K &key) const
+    {
+        m_lookups.fetch_add(1, std::memory_order_relaxed);
+        return std::visit([&](const auto &impl) -> const V & { return impl[key]; }, m_impl);
+    }
+
+    adaptive_backend backend() const
+    {
+        return m_backend;
+    }
+
+    // Number of representation changes so far.
+    std::size_t switchCount() const
+    {
+        return m_switchCount;
+    }
+
+    std::size_t size() const
+    {
+        return std::visit([](const auto &impl) { return impl.size(); }, m_impl);
+    }
+
+    const V &getValBegin() const
+    {
+        return std::visit([](const auto &impl) -> const V & { return impl.getValBegin(); }, m_impl);
+    }
+
+    std::string getMapSnippet() const
+    {
+        return std::visit([](const auto &impl) { return impl.getMapSnippet(); }, m_impl);
+    }
+
+    // Closes the current window once it holds at least window operations and switches the
+    // representation if the last two windows call for it. assign() calls it; must not run
+    // concurrently with any other call on the map.
+    void adapt()
+    {
+        const std::size_t lookups = m_lookups.load(std::memory_order_relaxed);
+        if (lookups + m_assigns < m_window)
+        {
+            return;
+        }
+        const adaptive_backend best = cheapestBackend(lookups);
+        m_candidateWindows = best == m_candidate ? m_candidateWindows + 1 : 1;
+        m_candidate = best;
+        if (best != m_backend && m_candidateWindows >= 2)
+        {
+            switchTo(best);
+        }
+        m_lookups.store(0, std::memory_order_relaxed);
+        m_assigns = m_tailAssigns = 0;
+    }
+
+private:
+    // windows over which the saving has to pay for the rebuild
+    static constexpr double switchPayback = 4;
+
+    adaptive_backend cheapestBackend(std::size_t lookupCount) const
+    {
+        const double n = static_cast<double>(size());
+        const double logN = std::log2(n + 2);
+        const double lookups = static_cast<double>(lookupCount);
+        const double tailAssigns = static_cast<double>(m_tailAssigns);
+        const double otherAssigns = static_cast<double>(m_assigns - m_tailAssigns);
+
+        const double costs[] = {
+            lookups * 3 * logN + (tailAssigns + otherAssigns) * 4 * logN,
+            lookups * logN + tailAssigns * logN + otherAssigns * (logN + n / 8),
+            m_assigns == 0 ? lookups * 0.7 * logN : INFINITY,
+        };
+        const double current = costs[static_cast<int>(m_backend)];
+        adaptive_backend best = m_backend;
+        for (int backend = 0; backend < 3; backend++)
+        {
+            const double saving = current - costs[backend];
+            if (costs[backend] * 1.25 < current && saving * switchPayback > 2 * n && costs[backend] < costs[static_cast<int>(best)])
+            {
+                best = static_cast<adaptive_backend>(backend);
+            }
+        }
+        return best;
+    }
+
+    void switchTo(adaptive_backend backend)
+    {
+        V valBegin = getValBegin();
+        std::vector<std::pair<K, V>> boundaries;
+        boundaries.reserve(size());
+        if (const auto *frozen = std::get_if<frozen_interval_map<K, V>>(&m_impl))
+        {
+            for (std::size_t i = 0; i < frozen->size(); i++)
+            {
+                boundaries.emplace_back(frozen->keys()[i], frozen->values()[i + 1]);
+            }
+        }
+        else
+        {
+            std::visit([&](const auto &impl)
+            {
+                if constexpr (!std::is_same_v<std::decay_t<decltype(impl)>, frozen_interval_map<K, V>>)
+                {
+                    for (const auto &[key, value]: impl)
+                    {
+                        boundaries.emplace_back(key, value);
+                    }
+                }
+            }, m_impl);
+        }
+
+        switch (backend)
+        {
+        case adaptive_backend::tree:
+            m_impl.template emplace<interval_map<K, V>>(valBegin, boundaries.begin(), boundaries.end());
+            break;
+        case adaptive_backend::flat:
+            m_impl.template emplace<append_interval_map<K, V>>(valBegin, boundaries.begin(), boundaries.end());
+            break;
+        case adaptive_backend::frozen:
+            m_impl.template emplace<frozen_interval_map<K, V>>(valBegin, boundaries.begin(), boundaries.end());
+            break;
+        }
+        m_backend = backend;
+        m_switchCount++;
+    }
+
+    std::variant<interval_map<K, V>, append_interval_map<K, V>, frozen_interval_map<K, V>> m_impl;
+    adaptive_backend m_backend = adaptive_backend::tree;
+    adaptive_backend m_candidate = adaptive_backend::tree;
+    std::size_t m_candidateWindows = 0;
+    std::size_t m_switchCount = 0;
+
+    const std::size_t m_window;
+    std::size_t m_assigns = 0;
+    std::size_t m_tailAssigns = 0;
+    // the only statistic lookups touch
+    mutable std::atomic<std::size_t> m_lookups{0};
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "interval_map.h"
+
+
+/*
+    interval_map for keys that mostly grow monotonically, e.g. timestamps.
+
+    The boundaries live in a std::deque (a vector of fixed-size chunks, so growing never moves
+    existing entries). assign() searches for the affected range by galloping backwards from the
+    last boundary, therefore extending or overwriting the tail costs amortized O(1): the search
+    only visits the entries it is about to pop. Assigns further inside are still correct; they cost
+    O(log d) to find the range plus moving the entries on the shorter side of it.
+
+    Lookups use interpolation search for arithmetic keys and binary search otherwise.
+*/
+template<typename K, typename V>
+class append_interval_map
+{
+public:
+    explicit append_interval_map(const V &value)
+        : m_valBegin(value)
+    { }
+
+    // Builds the map from (key, value) boundaries given in strictly increasing key order.
+    // Entries that repeat the value in effect before them are skipped.
+    template<typename InputIt>
+    append_interval_map(const V &value, InputIt first, InputIt last)
+        : m_valBegin(value)
+    {
+        const V *previous = &m_valBegin;
+        for (; first != last; ++first)
+        {
+            const auto &[key, val] = *first;
+            if (!(val == *previous))
+            {
+                // push_back keeps references to existing entries valid
+                previous = &m_entries.emplace_back(key, val).second;
+            }
+        }
+    }
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        const std::size_t last = lowerBoundFromBack(keyEnd, m_entries.size());
+        const std::size_t first = lowerBoundFromBack(keyBegin, last);
+        // [first, last) are the boundaries inside [keyBegin, keyEnd)
+
+        std::size_t eraseBegin = first;
+        std::size_t eraseEnd = last;
+
+        // keep the value that is in effect from keyEnd on
+        if (last == m_entries.size() || keyEnd < m_entries[last].first)
+        {
+            if (last > first)
+            {
+                if (!(m_entries[last - 1].second == val))
+                {
+                    // the last boundary inside the range holds that value, move it to keyEnd
+                    m_entries[last - 1].first = keyEnd;
+                    eraseEnd = last - 1;
+                }
+            }
+            else
+            {
+                const V &current = first == 0 ? m_valBegin : m_entries[first - 1].second;
+                if (!(current == val))
+                {
+                    if (last == m_entries.size())
+                    {
+                        // push_back keeps references to existing entries valid
+                        m_entries.emplace_back(keyEnd, current);
+                    }
+                    else
+                    {
+                        V copy = current;
+                        m_entries.emplace(m_entries.begin() + last, keyEnd, std::move(copy));
+                    }
+                }
+            }
+        }
+        else if (m_entries[last].second == val)
+        {
+            eraseEnd = last + 1;
+        }
+
+        const V &before = first == 0 ? m_valBegin : m_entries[first - 1].second;
+        if (!(before == val))
+        {
+            if (eraseBegin < eraseEnd)
+            {
+                m_entries[eraseBegin].first = keyBegin;
+                m_entries[eraseBegin].second = val;
+                eraseBegin++;
+            }
+            else
+            {
+                m_entries.emplace(m_entries.begin() + eraseBegin, keyBegin, val);
+            }
+        }
+
+        // at the tail this just pops entries
+        m_entries.erase(m_entries.begin() + eraseBegin, m_entries.begin() + eraseEnd);
+    }
+
+    const V &operator[](const K &key) const
+    {
+        const std::size_t position = upperBound(key);
+        return position == 0 ? m_valBegin : m_entries[position - 1].second;
+    }
+
+    const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    std::size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    // Read-only access to the boundaries in key order.
+    auto begin() const
+    {
+        return m_entries.begin();
+    }
+
+    auto end() const
+    {
+        return m_entries.end();
+    }
+
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        for (const auto &[key, value]: m_entries)
+        {
+            out = detail::writeBoundary(out, key, value);
+        }
+        return result;
+    }
+
+private:
+    // Index of the first entry in [0, end) whose key is not less than key, found by galloping
+    // backwards from end: O(log d) where d is the distance of the result from end.
+    std::size_t lowerBoundFromBack(const K &key, std::size_t end) const
+    {
+        std::size_t high = end;
+        std::size_t step = 1;
+        while (high > 0 && !(m_entries[high - 1].first < key))
+        {
+            // m_entries[high - 1] is not less than key, so the result is at most high - 1
+            const std::size_t low = high > step ? high - step : 0;
+            if (m_entries[low].first < key)
+            {
+                return std::partition_point(m_entries.begin() + low, m_entries.begin() + high,
+                                            [&key](const auto &entry) { return entry.first < key; })
+                       - m_entries.begin();
+            }
+            high = low;
+            step *= 2;
+        }
+        return high;
+    }
+
+    // Number of entries whose key is not greater than key.
+    std::size_t upperBound(const K &key) const
+    {
+        std::size_t low = 0;
+        std::size_t high = m_entries.size();
+        if constexpr (std::is_arithmetic_v<K>)
+        {
+            // interpolation steps while they keep narrowing the range well, then binary search;
+            // invariant: entries below low are <= key, entries from high on are > key
+            for (int probe = 0; probe < 8 && high - low > 16; probe++)
+            {
+                const K &lowKey = m_entries[low].first;
+                const K &highKey = m_entries[high - 1].first;
+                if (key < lowKey)
+                {
+                    return low;
+                }
+                if (!(key < highKey))
+                {
+                    return high;
+                }
+                const long double fraction = (static_cast<long double>(key) - static_cast<long double>(lowKey))
+                                             / (static_cast<long double>(highKey) - static_cast<long double>(lowKey));
+                std::size_t position = low + static_cast<std::size_t>(fraction * static_cast<long double>(high - 1 - low));
+                position = std::min(std::max(position, low + 1), high - 2);
+                if (key < m_entries[position].first)
+                {
+                    high = position;
+                }
+                else
+                {
+                    low = position + 1;
+                }
+            }
+        }
+        return std::partition_point(m_entries.begin() + low, m_entries.begin() + high,
+                                    [&key](const auto &entry) { return !(key < entry.first); })
+               - m_entries.begin();
+    }
+
+    V m_valBegin;
+    std::deque<std::pair<K, V>> m_entries;
+};
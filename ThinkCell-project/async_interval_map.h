@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "interval_map.h"
+
+
+/*
+    interval_map whose writers only enqueue: asyncAssign() appends the operation to a bounded queue
+    and returns, and a dedicated applier thread drains the queue in batches. Before it takes the
+    write lock, the applier coalesces a batch: consecutive operations with equal values that
+    overlap or touch become one, and operations that later ones in the batch overwrite completely
+    are dropped, which leaves the map the same. Batches that rarely overwrite themselves stop
+    looking for hidden operations early, so they pay little for it. Each batch takes the write lock of the map once,
+    so readers and the applier hand over per batch, not per assign.
+    Batches are not applied in bulk mode (interval_map::beginBulk()): ending it canonicalizes the
+    whole map, which costs more than a batch of canonical assigns on a large map.
+
+    The queue is two vectors swapped between producers and the applier, so it allocates nothing
+    once both have reached capacity. Producers block while capacity operations are pending.
+
+    Reads see the operations applied so far; flush() or barrier() waits until everything enqueued
+    before it is visible, for read-your-writes.
+
+    If an assign throws on the applier thread (bad_alloc, a throwing copy of V), the exception is
+    kept: the rest of that batch and every later operation are dropped, and flush(), barrier()
+    and asyncAssign() report the first exception from then on. The map stays readable in the
+    state the failed assign left it in.
+*/
+template<typename K, typename V>
+class async_interval_map
+{
+public:
+    explicit async_interval_map(const V &value, std::size_t capacity = 4096)
+        : m_map(value)
+        , m_capacity(capacity == 0 ? 1 : capacity)
+    {
+        m_pending.reserve(m_capacity);
+        m_batch.reserve(m_capacity);
+        m_applier = std::thread([this] { applyLoop(); });
+    }
+
+    async_interval_map(const async_interval_map &) = delete;
+    async_interval_map &operator=(const async_interval_map &) = delete;
+
+    // Applies everything still queued, then stops the applier.
+    ~async_interval_map()
+    {
+        {
+            std::lock_guard<std::mutex> guard{m_queueMutex};
+            m_stopping = true;
+        }
+        m_queued.notify_one();
+        m_applier.join();
+    }
+
+    // Same contract as interval_map::assign, applied later by the applier thread in enqueue order.
+    void asyncAssign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> guard{m_queueMutex};
+            m_drained.wait(guard, [this] { return m_pending.size() < m_capacity || m_error; });
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+            m_pending.push_back({keyBegin, keyEnd, val});
+            m_enqueued++;
+        }
+        m_queued.notify_one();
+    }
+
+    // Blocks until every asyncAssign() that returned before the call is applied; rethrows the
+    // exception of a failed assign.
+    void flush()
+    {
+        std::unique_lock<std::mutex> guard{m_queueMutex};
+        const std::uint64_t target = m_enqueued;
+        m_applied.wait(guard, [&] { return m_appliedCount >= target; });
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    // Non-blocking flush(): the future becomes ready once every asyncAssign() that returned
+    // before the call is applied, and holds the exception of a failed assign.
+    std::future<void> barrier()
+    {
+        std::promise<void> promise;
+        std::future<void> result = promise.get_future();
+        std::lock_guard<std::mutex> guard{m_queueMutex};
+        if (m_error)
+        {
+            promise.set_exception(m_error);
+        }
+        else if (m_appliedCount >= m_enqueued)
+        {
+            promise.set_value();
+        }
+        else
+        {
+            m_barriers.emplace_back(m_enqueued, std::move(promise));
+        }
+        return result;
+    }
+
+    V operator[](const K &key) const
+    {
+        std::shared_lock<std::shared_mutex> guard{m_mapMutex};
+        return m_map[key];
+    }
+
+    // Calls fn(map) with the applied state, which stays unchanged until fn returns.
+    template<typename Fn>
+    decltype(auto) read(Fn fn) const
+    {
+        std::shared_lock<std::shared_mutex> guard{m_mapMutex};
+        return fn(static_cast<const interval_map<K, V> &>(m_map));
+    }
+
+private:
+    struct operation
+    {
+        K keyBegin;
+        K keyEnd;
+        V val;
+    };
+
+    void applyLoop()
+    {
+        for (;;)
+        {
+            std::uint64_t batchEnd;
+            {
+                std::unique_lock<std::mutex> guard{m_queueMutex};
+                m_queued.wait(guard, [this] { return !m_pending.empty() || m_stopping; });
+                if (m_pending.empty())
+                {
+                    return;
+                }
+                m_pending.swap(m_batch);
+                batchEnd = m_enqueued;
+            }
+            m_drained.notify_all();
+
+            std::exception_ptr error;
+            try
+            {
+                coalesce();
+                std::lock_guard<std::shared_mutex> guard{m_mapMutex};
+                for (const operation &op: m_batch)
+                {
+                    m_map.assign(op.keyBegin, op.keyEnd, op.val);
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            m_batch.clear();
+
+            std::vector<std::promise<void>> ready;
+            {
+                std::lock_guard<std::mutex> guard{m_queueMutex};
+                if (error && !m_error)
+                {
+                    m_error = error;
+                }
+                error = m_error;
+                if (error)
+                {
+                    // nothing is applied after a failure; count the dropped operations as done
+                    // so that waiters wake up and see the error
+                    m_pending.clear();
+                    batchEnd = m_enqueued;
+                }
+                m_appliedCount = batchEnd;
+                for (auto it = m_barriers.begin(); it != m_barriers.end(); )
+                {
+                    if (it->first <= batchEnd)
+                    {
+                        ready.push_back(std::move(it->second));
+                        it = m_barriers.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+            m_applied.notify_all();
+            m_drained.notify_all();
+            for (auto &promise: ready)
+            {
+                if (error)
+                {
+                    promise.set_exception(error);
+                }
+                else
+                {
+                    promise.set_value();
+                }
+            }
+        }
+    }
+
+    // Rewrites m_batch into fewer operations with the same effect, in O(b log b) for b operations
+    // and without touching m_map.
+    void coalesce()
+    {
+        if (m_batch.size() < 2)
+        {
+            return;
+        }
+
+        // merge runs of the same value whose ranges overlap or touch
+        std::size_t kept = 1;
+        for (std::size_t i = 1; i < m_batch.size(); i++)
+        {
+            operation &previous = m_batch[kept - 1];
+            operation &op = m_batch[i];
+            if (!(previous.keyEnd < op.keyBegin) && !(op.keyEnd < previous.keyBegin) && previous.val == op.val)
+            {
+                if (op.keyBegin < previous.keyBegin)
+                {
+                    previous.keyBegin = op.keyBegin;
+                }
+                if (previous.keyEnd < op.keyEnd)
+                {
+                    previous.keyEnd = op.keyEnd;
+                }
+                continue;
+            }
+            if (kept != i)
+            {
+                m_batch[kept] = std::move(op);
+            }
+            kept++;
+        }
+        m_batch.erase(m_batch.begin() + static_cast<std::ptrdiff_t>(kept), m_batch.end());
+
+        // walking backwards, drop what the keys covered by later operations hide; once fewer than
+        // one in eight operations turns out hidden, tracking the coverage costs more than it
+        // saves, and the rest is kept as it is
+        interval_map<K, bool> covered{false};
+        std::size_t write = m_batch.size();
+        for (std::size_t i = m_batch.size(); i-- > 0; )
+        {
+            const std::size_t examined = m_batch.size() - 1 - i;
+            if (examined != 0 && examined % 64 == 0 && (examined - (m_batch.size() - write)) * 8 < examined)
+            {
+                write = static_cast<std::size_t>(std::move_backward(m_batch.begin(), m_batch.begin() + static_cast<std::ptrdiff_t>(i + 1),
+                    m_batch.begin() + static_cast<std::ptrdiff_t>(write)) - m_batch.begin());
+                break;
+            }
+            const operation &op = m_batch[i];
+            auto next = covered.lowerBound(op.keyBegin);
+            if (next != covered.end() && !(op.keyBegin < next->first))
+            {
+                ++next;
+            }
+            // the boundary after keyBegin ends the covered run keyBegin may lie in
+            if (covered[op.keyBegin] && !(next->first < op.keyEnd))
+            {
+                continue;
+            }
+            covered.assign(op.keyBegin, op.keyEnd, true);
+            if (--write != i)
+            {
+                m_batch[write] = std::move(m_batch[i]);
+            }
+        }
+        m_batch.erase(m_batch.begin(), m_batch.begin() + static_cast<std::ptrdiff_t>(write));
+    }
+
+    interval_map<K, V> m_map;
+    mutable std::shared_mutex m_mapMutex;
+
+    const std::size_t m_capacity;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_drained;
+    std::condition_variable m_applied;
+    std::vector<operation> m_pending;
+    // owned by the applier thread while it is applied
+    std::vector<operation> m_batch;
+    std::uint64_t m_enqueued = 0;
+    std::uint64_t m_appliedCount = 0;
+    // (enqueued count the barrier waits for, its promise)
+    std::vector<std::pair<std::uint64_t, std::promise<void>>> m_barriers;
+    // first exception thrown by an assign on the applier thread
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+
+    std::thread m_applier;
+};
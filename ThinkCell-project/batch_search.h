@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+
+namespace detail
+{
+    // Number of keys in the sorted range [keys, keys + count) that are not greater than key.
+    // The halving sequence depends on count only, so the loop compiles to conditional moves.
+    template<typename K>
+    std::size_t branchlessUpperBound(const K *keys, std::size_t count, const K &key)
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        const K *base = keys;
+        for (std::size_t n = count; n > 1; )
+        {
+            const std::size_t half = n / 2;
+            base = key < base[half] ? base : base + half;
+            n -= half;
+        }
+        return static_cast<std::size_t>(base - keys) + !(key < *base);
+    }
+
+    // Calls store(i, branchlessUpperBound(keys, count, query[i])) for every query in [first, last).
+    //
+    // Group queries are searched in lockstep: each round advances all of them by one halving step
+    // and prefetches the element every one of them probes next, so the cache misses of the whole
+    // group overlap instead of forming one dependent chain per query.
+    template<std::size_t Group = 16, typename K, typename KeyIt, typename Store>
+    void batchUpperBound(const K *keys, std::size_t count, KeyIt first, KeyIt last, Store store)
+    {
+        const std::size_t total = static_cast<std::size_t>(last - first);
+        if (count == 0)
+        {
+            for (std::size_t i = 0; i < total; i++)
+            {
+                store(i, std::size_t(0));
+            }
+            return;
+        }
+
+        const K *bases[Group];
+        for (std::size_t start = 0; start < total; start += Group)
+        {
+            const std::size_t size = std::min(Group, total - start);
+            for (std::size_t g = 0; g < size; g++)
+            {
+                bases[g] = keys;
+            }
+            for (std::size_t n = count; n > 1; )
+            {
+                const std::size_t half = n / 2;
+                n -= half;
+                for (std::size_t g = 0; g < size; g++)
+                {
+                    bases[g] = first[start + g] < bases[g][half] ? bases[g] : bases[g] + half;
+                    __builtin_prefetch(bases[g] + n / 2);
+                }
+            }
+            for (std::size_t g = 0; g < size; g++)
+            {
+                store(start + g, static_cast<std::size_t>(bases[g] - keys) + !(first[start + g] < *bases[g]));
+            }
+        }
+    }
+}
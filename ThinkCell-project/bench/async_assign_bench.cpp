@@ -0,0 +1,102 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "async_interval_map.h"
+#include "bench_util.h"
+#include "interval_map.h"
+
+
+/*
+    Caller-side latency of assign() on an interval_map shared under a mutex versus asyncAssign()
+    on async_interval_map, with several threads writing short random ranges concurrently.
+
+        async_assign_bench [threads] [assigns per thread] [queue capacity] [key space]
+
+    A small key space makes the assigns of a batch overlap, which the applier coalesces.
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using value_type = std::uint32_t;
+
+    template<typename Assign>
+    void run(const char *name, std::size_t threads, std::size_t assigns, key_type keySpace, Assign assign)
+    {
+        std::vector<latency_histogram> histograms(threads);
+        std::vector<std::thread> workers;
+        const auto start = bench_clock::now();
+        for (std::size_t thread = 0; thread < threads; thread++)
+        {
+            workers.emplace_back([&, thread]
+            {
+                std::mt19937_64 random{65 + thread};
+                for (std::size_t i = 0; i < assigns; i++)
+                {
+                    const key_type keyBegin = random() % keySpace;
+                    const key_type keyEnd = keyBegin + 1 + random() % 1000;
+                    const auto value = static_cast<value_type>(random() % 16);
+                    const auto callStart = bench_clock::now();
+                    assign(keyBegin, keyEnd, value);
+                    histograms[thread].add(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - callStart).count()));
+                }
+            });
+        }
+        for (auto &worker: workers)
+        {
+            worker.join();
+        }
+        const double seconds = secondsSince(start);
+
+        latency_histogram total;
+        for (const auto &histogram: histograms)
+        {
+            total.merge(histogram);
+        }
+        std::printf("%s: %.0f assigns/s\n", name, static_cast<double>(threads * assigns) / seconds);
+        total.print("  ");
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t threads = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    const std::size_t assigns = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    const std::size_t capacity = argc >= 4 ? std::strtoull(argv[3], nullptr, 10) : 4096;
+    const key_type keySpace = argc >= 5 ? std::strtoull(argv[4], nullptr, 10) : 100000000;
+    if (threads == 0 || keySpace == 0)
+    {
+        std::fprintf(stderr, "usage: %s [threads] [assigns per thread] [queue capacity] [key space]\n", argv[0]);
+        return 2;
+    }
+
+    {
+        interval_map<key_type, value_type> map{0};
+        std::mutex mutex;
+        run("assign under a mutex", threads, assigns, keySpace, [&](key_type keyBegin, key_type keyEnd, value_type value)
+        {
+            std::lock_guard<std::mutex> guard{mutex};
+            map.assign(keyBegin, keyEnd, value);
+        });
+        doNotOptimize(map.size());
+    }
+    {
+        async_interval_map<key_type, value_type> map{0, capacity};
+        run("asyncAssign", threads, assigns, keySpace, [&](key_type keyBegin, key_type keyEnd, value_type value)
+        {
+            map.asyncAssign(keyBegin, keyEnd, value);
+        });
+        const auto start = bench_clock::now();
+        map.flush();
+        std::printf("  final flush %.3f s\n", secondsSince(start));
+    }
+    return 0;
+}
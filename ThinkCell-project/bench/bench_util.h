@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+
+// Helpers shared by the benchmark executables; not part of the interval_map headers.
+
+using bench_clock = std::chrono::steady_clock;
+
+inline double secondsSince(bench_clock::time_point start)
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// Keeps the compiler from dropping computations whose result is otherwise unused.
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+// Latency histogram with power-of-two nanosecond buckets: bucket i counts samples in [2^i, 2^(i+1)).
+class latency_histogram
+{
+public:
+    void add(std::uint64_t nanoseconds)
+    {
+        int bucket = 0;
+        while (bucket + 1 < bucketCount && (nanoseconds >> (bucket + 1)) != 0)
+        {
+            bucket++;
+        }
+        m_buckets[bucket]++;
+        m_count++;
+        if (nanoseconds > m_max)
+        {
+            m_max = nanoseconds;
+        }
+    }
+
+    void merge(const latency_histogram &other)
+    {
+        for (int bucket = 0; bucket < bucketCount; bucket++)
+        {
+            m_buckets[bucket] += other.m_buckets[bucket];
+        }
+        m_count += other.m_count;
+        if (other.m_max > m_max)
+        {
+            m_max = other.m_max;
+        }
+    }
+
+    std::uint64_t count() const
+    {
+        return m_count;
+    }
+
+    std::uint64_t max() const
+    {
+        return m_max;
+    }
+
+    // Upper edge of the bucket holding the given quantile (0..1).
+    std::uint64_t quantile(double q) const
+    {
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(m_count));
+        std::uint64_t seen = 0;
+        for (int bucket = 0; bucket < bucketCount; bucket++)
+        {
+            seen += m_buckets[bucket];
+            if (seen > rank)
+            {
+                return std::uint64_t(2) << bucket;
+            }
+        }
+        return m_max;
+    }
+
+    void print(const char *indent) const
+    {
+        std::printf("%sp50 <%llu ns  p90 <%llu ns  p99 <%llu ns  p99.9 <%llu ns  max %llu ns\n", indent,
+                    ull(quantile(0.5)), ull(quantile(0.9)), ull(quantile(0.99)), ull(quantile(0.999)), ull(m_max));
+        for (int bucket = 0; bucket < bucketCount; bucket++)
+        {
+            if (m_buckets[bucket] != 0)
+            {
+                std::printf("%s  [%8llu, %8llu) ns %10llu\n", indent, ull(std::uint64_t(1) << bucket),
+                            ull(std::uint64_t(2) << bucket), ull(m_buckets[bucket]));
+            }
+        }
+    }
+
+private:
+    static constexpr int bucketCount = 40;
+
+    static unsigned long long ull(std::uint64_t value)
+    {
+        return static_cast<unsigned long long>(value);
+    }
+
+    std::array<std::uint64_t, bucketCount> m_buckets{};
+    std::uint64_t m_count = 0;
+    std::uint64_t m_max = 0;
+};
@@ -0,0 +1,90 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <utility>
+
+#include "bench_util.h"
+#include "interval_map.h"
+#include "node_arena.h"
+
+
+/*
+    Node layout and in-order traversal time of an interval_map after a long run of random assigns,
+    before and after compact(), with std::allocator and with node_arena_allocator.
+
+        compact_bench [assigns] [traversals]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using value_type = std::uint32_t;
+
+    constexpr key_type keySpace = 100000000;
+
+    template<typename Map>
+    void churn(Map &map, std::size_t assigns)
+    {
+        std::mt19937_64 random{70};
+        for (std::size_t i = 0; i < assigns; i++)
+        {
+            const key_type keyBegin = random() % keySpace;
+            const key_type keyEnd = keyBegin + 1 + random() % 2000;
+            map.assign(keyBegin, keyEnd, static_cast<value_type>(random() % 16));
+        }
+    }
+
+    template<typename Map>
+    void report(const char *name, const Map &map, std::size_t traversals)
+    {
+        const layout_stats stats = map.layout();
+        std::uint64_t sum = 0;
+        const auto start = bench_clock::now();
+        for (std::size_t pass = 0; pass < traversals; pass++)
+        {
+            for (const auto &[key, value]: map)
+            {
+                sum += key ^ value;
+            }
+        }
+        doNotOptimize(sum);
+        const double seconds = secondsSince(start);
+        std::printf("%-24s %zu entries, %5.1f%% sequential, mean distance %10.0f B, %6.2f ns per entry\n",
+            name, stats.entries, 100 * stats.sequentialFraction(), stats.meanDistance,
+            seconds * 1e9 / static_cast<double>(stats.entries * traversals));
+    }
+
+    template<typename Map>
+    void run(const char *name, Map map, std::size_t assigns, std::size_t traversals)
+    {
+        std::printf("%s\n", name);
+        churn(map, assigns);
+        report("  before compact()", map, traversals);
+        const auto start = bench_clock::now();
+        map.compact();
+        const double seconds = secondsSince(start);
+        report("  after compact()", map, traversals);
+        std::printf("  compact() took %.3f s\n", seconds);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t assigns = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const std::size_t traversals = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 10;
+    if (assigns == 0 || traversals == 0)
+    {
+        std::fprintf(stderr, "usage: %s [assigns] [traversals]\n", argv[0]);
+        return 2;
+    }
+
+    run("std::allocator", interval_map<key_type, value_type>{0}, assigns, traversals);
+
+    using allocator = node_arena_allocator<std::pair<const key_type, value_type>>;
+    run("node_arena_allocator", interval_map<key_type, value_type, std::equal_to<value_type>, allocator>{0, allocator()}, assigns, traversals);
+    return 0;
+}
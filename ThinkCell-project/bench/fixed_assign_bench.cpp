@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "bench_util.h"
+#include "fixed_interval_map.h"
+#include "interval_map.h"
+
+
+/*
+    Latency distribution of assign() on fixed_interval_map<K, V, 64> versus interval_map<K, V>
+    holding a similar number of boundaries, for random short assigns in a small key range. The
+    maximum matters here: interval_map allocates and frees nodes, fixed_interval_map never does.
+
+        fixed_assign_bench [assigns]
+*/
+
+namespace
+{
+    using key_type = std::uint32_t;
+    using value_type = std::uint32_t;
+
+    constexpr key_type keySpace = 256;
+
+    template<typename Assign>
+    void run(const char *name, std::size_t assigns, Assign assign)
+    {
+        latency_histogram histogram;
+        std::size_t rejected = 0;
+        std::mt19937 random{75};
+        for (std::size_t i = 0; i < assigns; i++)
+        {
+            const key_type keyBegin = random() % keySpace;
+            const key_type keyEnd = keyBegin + 1 + random() % 16;
+            const auto value = static_cast<value_type>(random() % 4);
+            const auto start = bench_clock::now();
+            rejected += !assign(keyBegin, keyEnd, value);
+            histogram.add(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count()));
+        }
+        std::printf("%s: %zu rejected\n", name, rejected);
+        histogram.print("  ");
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t assigns = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (assigns == 0)
+    {
+        std::fprintf(stderr, "usage: %s [assigns]\n", argv[0]);
+        return 2;
+    }
+
+    {
+        interval_map<key_type, value_type> map{0};
+        run("interval_map", assigns, [&](key_type keyBegin, key_type keyEnd, value_type value)
+        {
+            map.assign(keyBegin, keyEnd, value);
+            return true;
+        });
+        doNotOptimize(map.size());
+    }
+    {
+        fixed_interval_map<key_type, value_type, 64> map{0};
+        run("fixed_interval_map<64>", assigns, [&](key_type keyBegin, key_type keyEnd, value_type value)
+        {
+            return map.assign(keyBegin, keyEnd, value);
+        });
+        doNotOptimize(map.size());
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench_util.h"
+#include "frozen_interval_map.h"
+#include "interval_map.h"
+
+
+/*
+    Compares a plain loop of operator[] on interval_map and on frozen_interval_map with
+    frozen_interval_map::lookupBatch, for unsorted keys.
+
+        interval_map_lookup_bench [boundaries] [lookups] [batch]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using value_type = std::uint32_t;
+
+    std::uint64_t checksum(const std::vector<value_type> &values)
+    {
+        std::uint64_t sum = 0;
+        for (const value_type value: values)
+        {
+            sum = sum * 31 + value;
+        }
+        return sum;
+    }
+
+    template<typename Map>
+    double loop(const Map &map, const std::vector<key_type> &keys, std::vector<value_type> &looped)
+    {
+        looped.resize(keys.size());
+        const auto start = bench_clock::now();
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            looped[i] = map[keys[i]];
+        }
+        const double seconds = secondsSince(start);
+        doNotOptimize(looped.data());
+        return seconds;
+    }
+
+    void run(const interval_map<key_type, value_type> &map, const std::vector<key_type> &keys)
+    {
+        std::vector<value_type> looped;
+        const double loopSeconds = loop(map, keys, looped);
+        std::printf("%-20s loop %7.1f ns/lookup\n", "interval_map", loopSeconds * 1e9 / static_cast<double>(keys.size()));
+    }
+
+    void run(const frozen_interval_map<key_type, value_type> &map, const std::vector<key_type> &keys, std::size_t batch)
+    {
+        std::vector<value_type> looped;
+        const double loopSeconds = loop(map, keys, looped);
+
+        std::vector<value_type> batched(keys.size());
+        const auto start = bench_clock::now();
+        for (std::size_t offset = 0; offset < keys.size(); offset += batch)
+        {
+            const std::size_t count = std::min(batch, keys.size() - offset);
+            map.lookupBatch(keys.begin() + offset, keys.begin() + offset + count, batched.begin() + offset);
+        }
+        const double batchSeconds = secondsSince(start);
+        doNotOptimize(batched.data());
+
+        const double lookups = static_cast<double>(keys.size());
+        std::printf("%-20s loop %7.1f ns/lookup  batch %7.1f ns/lookup  speedup %.2fx%s\n", "frozen_interval_map",
+                    loopSeconds * 1e9 / lookups, batchSeconds * 1e9 / lookups, loopSeconds / batchSeconds,
+                    checksum(looped) == checksum(batched) ? "" : "  RESULTS DIFFER");
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t boundaries = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::size_t lookups = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 4000000;
+    const std::size_t batch = argc >= 4 ? std::strtoull(argv[3], nullptr, 10) : 4096;
+    if (boundaries == 0 || batch == 0)
+    {
+        std::fprintf(stderr, "usage: %s [boundaries] [lookups] [batch]\n", argv[0]);
+        return 2;
+    }
+
+    std::mt19937_64 random{59};
+    std::vector<std::pair<key_type, value_type>> entries(boundaries);
+    key_type key = 0;
+    for (std::size_t i = 0; i < boundaries; i++)
+    {
+        key += 1 + random() % 1000;
+        entries[i] = {key, static_cast<value_type>(i + 1)};
+    }
+    const interval_map<key_type, value_type> imap{0, entries.begin(), entries.end()};
+    const frozen_interval_map<key_type, value_type> frozen{imap};
+
+    std::vector<key_type> queries(lookups);
+    for (key_type &query: queries)
+    {
+        query = random() % (key + 1000);
+    }
+
+    std::printf("%zu boundaries, %zu unsorted lookups in batches of %zu\n", imap.size(), lookups, batch);
+    run(imap, queries);
+    run(frozen, queries, batch);
+    return 0;
+}
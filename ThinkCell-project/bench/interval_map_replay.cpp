@@ -0,0 +1,270 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "append_interval_map.h"
+#include "bench_util.h"
+#include "bitmap_interval_map.h"
+#include "interval_map.h"
+#include "interval_map_trace.h"
+#include "radix_interval_map.h"
+#include "small_interval_map.h"
+
+
+/*
+    Replays a trace recorded by interval_map_trace_writer against every backend and reports
+    throughput, per-operation latency and peak heap usage.
+
+        interval_map_replay <trace>
+        interval_map_replay --generate <trace> <operations> [seed]
+*/
+
+namespace
+{
+    // Heap accounting for the peak memory figure; every allocation carries its size in front.
+    std::atomic<std::size_t> liveBytes{0};
+    std::atomic<std::size_t> peakBytes{0};
+
+    constexpr std::size_t allocationHeader = alignof(std::max_align_t);
+
+    void *trackedAllocate(std::size_t size)
+    {
+        auto *block = static_cast<unsigned char *>(std::malloc(size + allocationHeader));
+        if (!block)
+        {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<std::size_t *>(block) = size;
+        const std::size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        { }
+        return block + allocationHeader;
+    }
+
+    void trackedFree(void *pointer)
+    {
+        if (pointer)
+        {
+            auto *block = static_cast<unsigned char *>(pointer) - allocationHeader;
+            liveBytes.fetch_sub(*reinterpret_cast<std::size_t *>(block), std::memory_order_relaxed);
+            std::free(block);
+        }
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+
+namespace
+{
+    template<typename Map, typename K, typename V>
+    void replayBackend(const char *name, const std::vector<trace_op<K, V>> &ops, const V &initialValue)
+    {
+        std::uint64_t assigns = 0;
+        for (const auto &op: ops)
+        {
+            assigns += op.opcode == trace_opcode::assign;
+        }
+
+        // throughput and peak memory, without clock reads between operations
+        double checksum = 0;
+        double seconds;
+        std::size_t peak;
+        {
+            const std::size_t baseline = liveBytes.load();
+            peakBytes.store(baseline);
+            Map map{initialValue};
+            const auto start = bench_clock::now();
+            for (const auto &op: ops)
+            {
+                if (op.opcode == trace_opcode::assign)
+                {
+                    map.assign(op.keyBegin, op.keyEnd, op.value);
+                }
+                else
+                {
+                    checksum += static_cast<double>(map[op.keyBegin]);
+                }
+            }
+            seconds = secondsSince(start);
+            peak = peakBytes.load() - baseline;
+        }
+
+        // latency of the individual operations
+        latency_histogram assignLatency;
+        latency_histogram lookupLatency;
+        {
+            Map map{initialValue};
+            for (const auto &op: ops)
+            {
+                const auto start = bench_clock::now();
+                if (op.opcode == trace_opcode::assign)
+                {
+                    map.assign(op.keyBegin, op.keyEnd, op.value);
+                    assignLatency.add(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count());
+                }
+                else
+                {
+                    doNotOptimize(map[op.keyBegin]);
+                    lookupLatency.add(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count());
+                }
+            }
+        }
+
+        std::printf("%s\n", name);
+        std::printf("  %llu operations (%llu assign, %llu lookup) in %.3f s: %.0f ops/s\n",
+                    static_cast<unsigned long long>(ops.size()), static_cast<unsigned long long>(assigns),
+                    static_cast<unsigned long long>(ops.size() - assigns), seconds, static_cast<double>(ops.size()) / seconds);
+        std::printf("  peak heap %.1f KiB, lookup checksum %.17g\n", static_cast<double>(peak) / 1024, checksum);
+        if (assignLatency.count())
+        {
+            std::printf("  assign latency\n");
+            assignLatency.print("    ");
+        }
+        if (lookupLatency.count())
+        {
+            std::printf("  lookup latency\n");
+            lookupLatency.print("    ");
+        }
+    }
+
+    template<typename K, typename V>
+    void replayAllBackends(const interval_map_trace_reader &trace)
+    {
+        const auto ops = trace.operations<K, V>();
+        const V initialValue = trace.initialValue<K, V>();
+
+        replayBackend<interval_map<K, V>>("interval_map (std::map)", ops, initialValue);
+        replayBackend<small_interval_map<K, V>>("small_interval_map (8 inline)", ops, initialValue);
+        replayBackend<append_interval_map<K, V>>("append_interval_map (std::deque)", ops, initialValue);
+        if constexpr (std::is_unsigned_v<K>)
+        {
+            replayBackend<radix_interval_map<K, V>>("radix_interval_map (256-way)", ops, initialValue);
+        }
+        if constexpr (std::is_same_v<K, std::uint32_t> && std::is_same_v<V, bool>)
+        {
+            replayBackend<bitmap_interval_map>("bitmap_interval_map (roaring containers)", ops, initialValue);
+        }
+    }
+
+    template<typename K>
+    bool dispatchValue(const interval_map_trace_reader &trace)
+    {
+        switch (trace.valueType())
+        {
+            case trace_type::character: replayAllBackends<K, char>(trace); return true;
+            case trace_type::boolean: replayAllBackends<K, bool>(trace); return true;
+            case trace_type::int32: replayAllBackends<K, std::int32_t>(trace); return true;
+            case trace_type::uint32: replayAllBackends<K, std::uint32_t>(trace); return true;
+            case trace_type::int64: replayAllBackends<K, std::int64_t>(trace); return true;
+            case trace_type::uint64: replayAllBackends<K, std::uint64_t>(trace); return true;
+            case trace_type::float64: replayAllBackends<K, double>(trace); return true;
+            default: return false;
+        }
+    }
+
+    bool dispatch(const interval_map_trace_reader &trace)
+    {
+        switch (trace.keyType())
+        {
+            case trace_type::int32: return dispatchValue<std::int32_t>(trace);
+            case trace_type::uint32: return dispatchValue<std::uint32_t>(trace);
+            case trace_type::int64: return dispatchValue<std::int64_t>(trace);
+            case trace_type::uint64: return dispatchValue<std::uint64_t>(trace);
+            case trace_type::float64: return dispatchValue<double>(trace);
+            default: return false;
+        }
+    }
+
+    // Synthetic interval_map<int, char> traffic: 20% assigns of short random ranges, 80% lookups.
+    void generate(const std::string &path, std::uint64_t operations, std::uint32_t seed)
+    {
+        interval_map_trace_writer<int, char> writer{path, 'A'};
+        traced_interval_map<int, char> map{'A', &writer};
+
+        std::mt19937 random{seed};
+        std::uniform_int_distribution<int> key{0, 1000000};
+        std::uniform_int_distribution<int> length{1, 1000};
+        std::uniform_int_distribution<int> value{'A', 'H'};
+        std::uniform_int_distribution<int> kind{0, 4};
+        for (std::uint64_t i = 0; i < operations; i++)
+        {
+            if (kind(random) == 0)
+            {
+                const int begin = key(random);
+                map.assign(begin, begin + length(random), static_cast<char>(value(random)));
+            }
+            else
+            {
+                doNotOptimize(map[key(random)]);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        if (argc >= 4 && std::string(argv[1]) == "--generate")
+        {
+            generate(argv[2], std::strtoull(argv[3], nullptr, 10), argc >= 5 ? std::strtoul(argv[4], nullptr, 10) : 1);
+            return 0;
+        }
+        if (argc != 2)
+        {
+            std::fprintf(stderr, "usage: %s <trace>\n       %s --generate <trace> <operations> [seed]\n", argv[0], argv[0]);
+            return 2;
+        }
+
+        const interval_map_trace_reader trace{argv[1]};
+        if (!dispatch(trace))
+        {
+            std::fprintf(stderr, "%s: key or value type of the trace is not supported by the replay tool\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    }
+    catch (const std::exception &error)
+    {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_util.h"
+#include "frozen_interval_map.h"
+#include "interval_map.h"
+#include "learned_interval_map.h"
+
+
+/*
+    Compares learned_interval_map lookups with the binary search of frozen_interval_map on uint64
+    boundary keys, for synthetic distributions and, optionally, for real keys read from a text file
+    with one unsigned integer per line (unsorted and duplicate keys are fine).
+
+        learned_index_bench [boundaries] [lookups] [keys file]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using value_type = std::uint32_t;
+
+    template<typename Map>
+    double nanosPerLookup(const Map &map, const std::vector<key_type> &queries, std::uint64_t &checksum)
+    {
+        const auto start = bench_clock::now();
+        std::uint64_t sum = 0;
+        for (const key_type query: queries)
+        {
+            sum = sum * 31 + map[query];
+        }
+        const double seconds = secondsSince(start);
+        doNotOptimize(sum);
+        checksum = sum;
+        return seconds * 1e9 / static_cast<double>(queries.size());
+    }
+
+    void run(const char *name, std::vector<key_type> keys, std::size_t lookups, std::mt19937_64 &random)
+    {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        if (keys.empty())
+        {
+            return;
+        }
+        std::vector<std::pair<key_type, value_type>> entries(keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            entries[i] = {keys[i], static_cast<value_type>(i + 1)};
+        }
+        const interval_map<key_type, value_type> imap{0, entries.begin(), entries.end()};
+        const frozen_interval_map<key_type, value_type> frozen{imap};
+
+        // half the queries hit a boundary exactly, half fall anywhere in the key range
+        std::vector<key_type> queries(lookups);
+        for (std::size_t i = 0; i < lookups; i++)
+        {
+            queries[i] = i % 2 == 0 ? keys[random() % keys.size()]
+                                    : keys.front() + random() % (keys.back() - keys.front() + 1);
+        }
+
+        std::uint64_t expected = 0;
+        std::printf("%s: %zu boundaries\n", name, keys.size());
+        std::printf("  %-24s %7.1f ns/lookup\n", "binary search", nanosPerLookup(frozen, queries, expected));
+        for (const std::size_t maxError: {8u, 32u, 128u})
+        {
+            const auto start = bench_clock::now();
+            const learned_interval_map<key_type, value_type> learned{imap, maxError};
+            const double buildSeconds = secondsSince(start);
+            std::uint64_t checksum = 0;
+            const double nanos = nanosPerLookup(learned, queries, checksum);
+            std::printf("  learned, maxError %-5zu %7.1f ns/lookup  %8zu segments  error %4zu  build %.3f s%s\n",
+                        maxError, nanos, learned.model().segmentCount(), learned.model().maxError(), buildSeconds,
+                        checksum == expected ? "" : "  RESULTS DIFFER");
+        }
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t boundaries = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    const std::size_t lookups = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 4000000;
+    if (boundaries == 0 || lookups == 0)
+    {
+        std::fprintf(stderr, "usage: %s [boundaries] [lookups] [keys file]\n", argv[0]);
+        return 2;
+    }
+    std::mt19937_64 random{60};
+
+    std::vector<key_type> keys(boundaries);
+    for (key_type &key: keys)
+    {
+        key = random() % (std::uint64_t(1) << 48);
+    }
+    run("uniform", keys, lookups, random);
+
+    std::lognormal_distribution<double> lognormal{0, 2};
+    for (key_type &key: keys)
+    {
+        key = static_cast<key_type>(std::min(lognormal(random) * 1e9, 1.8e19));
+    }
+    run("lognormal", keys, lookups, random);
+
+    // dense runs of consecutive timestamps separated by idle gaps
+    key_type key = 0;
+    for (std::size_t i = 0; i < boundaries; i++)
+    {
+        key += random() % 1000 == 0 ? random() % 100000000 : 1 + random() % 16;
+        keys[i] = key;
+    }
+    run("clustered", keys, lookups, random);
+
+    if (argc >= 4)
+    {
+        std::ifstream file{argv[3]};
+        if (!file)
+        {
+            std::fprintf(stderr, "cannot open %s\n", argv[3]);
+            return 1;
+        }
+        std::vector<key_type> fileKeys;
+        for (key_type value; file >> value; )
+        {
+            fileKeys.push_back(value);
+        }
+        run(argv[3], std::move(fileKeys), lookups, random);
+    }
+    return 0;
+}
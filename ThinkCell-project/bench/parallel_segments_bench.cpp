@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench_util.h"
+#include "interval_map.h"
+#include "parallel_for_each.h"
+
+
+/*
+    Scaling of parallelForEachSegment with a statistics-style pass (per-segment length histogram
+    and value checksum) from one thread up to every core, compared with a sequential loop.
+
+        parallel_segments_bench [boundaries] [rounds]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using value_type = std::uint32_t;
+
+    // A little work per segment, like validating or exporting it would take.
+    std::uint64_t visit(const key_type &segmentBegin, const key_type *segmentEnd, const value_type &value)
+    {
+        std::uint64_t hash = segmentBegin * 0x9E3779B97F4A7C15ull ^ value;
+        for (int round = 0; round < 8; round++)
+        {
+            hash ^= hash >> 29;
+            hash *= 0xBF58476D1CE4E5B9ull;
+        }
+        return hash + (segmentEnd ? *segmentEnd - segmentBegin : 0);
+    }
+
+    struct alignas(64) padded_sum
+    {
+        std::atomic<std::uint64_t> sum{0};
+    };
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t boundaries = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    const std::size_t rounds = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    if (boundaries == 0 || rounds == 0)
+    {
+        std::fprintf(stderr, "usage: %s [boundaries] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    // clustered keys, so that chunks of equal key width hold different numbers of segments
+    std::mt19937_64 random{66};
+    std::vector<std::pair<key_type, value_type>> entries(boundaries);
+    key_type key = 0;
+    for (std::size_t i = 0; i < boundaries; i++)
+    {
+        key += random() % 100 == 0 ? random() % 1000000 : 1 + random() % 10;
+        entries[i] = {key, static_cast<value_type>(i % 2 + 1)};
+    }
+    const interval_map<key_type, value_type> imap{0, entries.begin(), entries.end()};
+
+    auto start = bench_clock::now();
+    std::uint64_t expected = 0;
+    for (std::size_t round = 0; round < rounds; round++)
+    {
+        for (auto it = imap.begin(); it != imap.end(); )
+        {
+            const auto &[segmentBegin, value] = *it;
+            ++it;
+            expected += visit(segmentBegin, it == imap.end() ? nullptr : &it->first, value);
+        }
+    }
+    const double sequential = secondsSince(start) / static_cast<double>(rounds);
+    std::printf("%zu boundaries, sequential %.1f ms\n", imap.size(), sequential * 1e3);
+
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; ; threads = std::min(threads * 2, cores))
+    {
+        start = bench_clock::now();
+        std::uint64_t total = 0;
+        for (std::size_t round = 0; round < rounds; round++)
+        {
+            // one padded sum per thread (up to hash collisions), so the adds do not contend
+            std::vector<padded_sum> sums(64);
+            parallelForEachSegment(imap, [&](const key_type &segmentBegin, const key_type *segmentEnd, const value_type &value)
+            {
+                thread_local const std::size_t slot = std::hash<std::thread::id>{}(std::this_thread::get_id()) % 64;
+                sums[slot].sum.fetch_add(visit(segmentBegin, segmentEnd, value), std::memory_order_relaxed);
+            }, threads);
+            for (const padded_sum &sum: sums)
+            {
+                total += sum.sum.load();
+            }
+        }
+        const double parallel = secondsSince(start) / static_cast<double>(rounds);
+        std::printf("%3zu threads %8.1f ms  speedup %.2fx%s\n", threads, parallel * 1e3, sequential / parallel,
+                    total == expected ? "" : "  RESULTS DIFFER");
+        if (threads == cores)
+        {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "interval_map.h"
+#include "shared_value.h"
+
+
+/*
+    Random assigns of large values from a small palette on interval_map<K, V> versus
+    interval_map<K, shared_value<V>>, where V is a vector of doubles.
+
+        shared_value_bench [assigns] [value size] [palette size]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+    using big_value = std::vector<double>;
+
+    constexpr key_type keySpace = 100000000;
+
+    template<typename Value>
+    void run(const char *name, const std::vector<Value> &palette, std::size_t assigns)
+    {
+        interval_map<key_type, Value> map{palette[0]};
+        std::mt19937_64 random{73};
+        const auto start = bench_clock::now();
+        for (std::size_t i = 0; i < assigns; i++)
+        {
+            const key_type keyBegin = random() % keySpace;
+            const key_type keyEnd = keyBegin + 1 + random() % 2000;
+            map.assign(keyBegin, keyEnd, palette[random() % palette.size()]);
+        }
+        const double seconds = secondsSince(start);
+        doNotOptimize(map.size());
+        std::printf("%-36s %8zu entries, %9.0f assigns/s\n", name, map.size(), static_cast<double>(assigns) / seconds);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t assigns = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::size_t valueSize = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const std::size_t paletteSize = argc >= 4 ? std::strtoull(argv[3], nullptr, 10) : 16;
+    if (assigns == 0 || paletteSize == 0)
+    {
+        std::fprintf(stderr, "usage: %s [assigns] [value size] [palette size]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<big_value> values;
+    std::vector<shared_value<big_value>> handles;
+    for (std::size_t i = 0; i < paletteSize; i++)
+    {
+        // values that only differ at the end, so that comparing them scans everything
+        big_value value(valueSize, 1.0);
+        if (valueSize > 0)
+        {
+            value.back() = static_cast<double>(i);
+        }
+        values.push_back(value);
+        handles.emplace_back(value);
+    }
+
+    run("interval_map<K, vector<double>>", values, assigns);
+    run("interval_map<K, shared_value<...>>", handles, assigns);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+
+#include "bench_util.h"
+#include "interval_map.h"
+#include "string_interval_map.h"
+
+
+/*
+    Heap use and assign / lookup throughput of interval_map<K, std::string> versus
+    string_interval_map<K> for labels drawn from a small vocabulary. Heap use is the growth of
+    the bytes glibc malloc reports in use, including its per-allocation overhead.
+
+        string_label_bench [assigns] [labels] [label length]
+*/
+
+namespace
+{
+    using key_type = std::uint64_t;
+
+    constexpr key_type keySpace = 100000000;
+
+    std::size_t heapBytes()
+    {
+        return mallinfo2().uordblks;
+    }
+
+    template<typename Map>
+    void run(const char *name, const std::vector<std::string> &labels, std::size_t assigns)
+    {
+        const std::size_t bytesBefore = heapBytes();
+        Map map{labels[0]};
+
+        std::mt19937_64 random{72};
+        auto start = bench_clock::now();
+        for (std::size_t i = 0; i < assigns; i++)
+        {
+            const key_type keyBegin = random() % keySpace;
+            const key_type keyEnd = keyBegin + 1 + random() % 2000;
+            map.assign(keyBegin, keyEnd, labels[random() % labels.size()]);
+        }
+        const double assignSeconds = secondsSince(start);
+        const std::size_t bytes = heapBytes() - bytesBefore;
+
+        std::size_t length = 0;
+        start = bench_clock::now();
+        for (std::size_t i = 0; i < assigns; i++)
+        {
+            length += std::string_view(map[random() % keySpace]).size();
+        }
+        doNotOptimize(length);
+        const double lookupSeconds = secondsSince(start);
+
+        std::printf("%-34s %8zu entries, %10zu heap bytes (%5.1f per entry), %9.0f assigns/s, %9.0f lookups/s\n",
+            name, map.size(), bytes, static_cast<double>(bytes) / static_cast<double>(map.size()),
+            static_cast<double>(assigns) / assignSeconds, static_cast<double>(assigns) / lookupSeconds);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    const std::size_t assigns = argc >= 2 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::size_t labelCount = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const std::size_t labelLength = argc >= 4 ? std::strtoull(argv[3], nullptr, 10) : 24;
+    if (assigns == 0 || labelCount == 0)
+    {
+        std::fprintf(stderr, "usage: %s [assigns] [labels] [label length]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> labels;
+    for (std::size_t i = 0; i < labelCount; i++)
+    {
+        std::string label = "label " + std::to_string(i);
+        label.resize(std::max(label.size(), labelLength), '.');
+        labels.push_back(label);
+    }
+
+    run<interval_map<key_type, std::string>>("interval_map<K, std::string>", labels, assigns);
+    run<string_interval_map<key_type>>("string_interval_map<K>", labels, assigns);
+    return 0;
+}
@@ -0,0 +1,737 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "interval_map.h"
+
+
+/*
+    interval_map<std::uint32_t, bool> stored like a Roaring bitmap.
+
+    The key space is cut into 65536 chunks of 65536 keys. A chunk whose keys all have the map's
+    default value is not stored at all; every other chunk holds one of three containers:
+        array   sorted low 16 bits of the true keys, for at most 4096 of them
+        bitset  1024 words, one bit per key
+        run     sorted [first, last] ranges of true keys
+    assign() changes a chunk's container in place: it sets bits in a bitset and splices an array or
+    a run list. As in Roaring, the container is only converted, to whichever is smallest, when a
+    threshold is crossed: an array beyond 4096 values, a bitset down to 4096 set bits or full,
+    a run list beyond 2047 runs, where it outgrows a bitset. New chunks start as run lists.
+
+    Besides assign and operator[] the map supports &, | and ^, which combine the two maps chunk by
+    chunk (run/run and array/array directly, anything else word by word) instead of merging their
+    boundary sequences.
+*/
+
+namespace detail::bitmap
+{
+    constexpr std::uint32_t chunkSize = 1u << 16;
+    constexpr std::size_t wordCount = chunkSize / 64;
+    constexpr std::size_t arrayLimit = 4096;
+
+    using run = std::pair<std::uint16_t, std::uint16_t>; // first and last key, both included
+
+    struct array_container
+    {
+        std::vector<std::uint16_t> values;
+    };
+
+    struct bitset_container
+    {
+        std::vector<std::uint64_t> words;
+        std::uint32_t cardinality;
+    };
+
+    struct run_container
+    {
+        std::vector<run> runs;
+    };
+
+    using container = std::variant<array_container, bitset_container, run_container>;
+
+    enum class set_operation { intersection, join, difference };
+
+    inline bool apply(set_operation operation, bool a, bool b)
+    {
+        switch (operation)
+        {
+            case set_operation::intersection: return a && b;
+            case set_operation::join: return a || b;
+            default: return a != b;
+        }
+    }
+
+    inline std::uint64_t apply(set_operation operation, std::uint64_t a, std::uint64_t b)
+    {
+        switch (operation)
+        {
+            case set_operation::intersection: return a & b;
+            case set_operation::join: return a | b;
+            default: return a ^ b;
+        }
+    }
+
+    inline container uniform(bool value)
+    {
+        run_container result;
+        if (value)
+        {
+            result.runs.push_back({0, 0xFFFF});
+        }
+        return result;
+    }
+
+    inline bool contains(const container &chunk, std::uint16_t low)
+    {
+        if (const auto *array = std::get_if<array_container>(&chunk))
+        {
+            return std::binary_search(array->values.begin(), array->values.end(), low);
+        }
+        if (const auto *bitset = std::get_if<bitset_container>(&chunk))
+        {
+            return (bitset->words[low / 64] >> (low % 64)) & 1;
+        }
+        const auto &runs = std::get<run_container>(chunk).runs;
+        auto it = std::upper_bound(runs.begin(), runs.end(), low, [](std::uint16_t key, const run &r) { return key < r.first; });
+        return it != runs.begin() && low <= std::prev(it)->second;
+    }
+
+    inline std::uint32_t cardinality(const container &chunk)
+    {
+        if (const auto *array = std::get_if<array_container>(&chunk))
+        {
+            return static_cast<std::uint32_t>(array->values.size());
+        }
+        if (const auto *bitset = std::get_if<bitset_container>(&chunk))
+        {
+            return bitset->cardinality;
+        }
+        std::uint32_t result = 0;
+        for (const auto &[first, last]: std::get<run_container>(chunk).runs)
+        {
+            result += static_cast<std::uint32_t>(last - first) + 1;
+        }
+        return result;
+    }
+
+    inline std::vector<run> runsOfWords(const std::vector<std::uint64_t> &words)
+    {
+        std::vector<run> runs;
+        long start = -1;
+        for (std::size_t w = 0; w < wordCount; w++)
+        {
+            const std::uint64_t word = words[w];
+            if (start < 0 ? word == 0 : word == ~std::uint64_t(0))
+            {
+                continue;
+            }
+            for (unsigned bit = 0; bit < 64; bit++)
+            {
+                const bool set = (word >> bit) & 1;
+                const long position = static_cast<long>(w * 64 + bit);
+                if (set && start < 0)
+                {
+                    start = position;
+                }
+                else if (!set && start >= 0)
+                {
+                    runs.push_back({static_cast<std::uint16_t>(start), static_cast<std::uint16_t>(position - 1)});
+                    start = -1;
+                }
+            }
+        }
+        if (start >= 0)
+        {
+            runs.push_back({static_cast<std::uint16_t>(start), 0xFFFF});
+        }
+        return runs;
+    }
+
+    inline std::vector<run> toRuns(const container &chunk)
+    {
+        if (const auto *array = std::get_if<array_container>(&chunk))
+        {
+            std::vector<run> runs;
+            for (std::uint16_t value: array->values)
+            {
+                if (!runs.empty() && runs.back().second + 1 == value)
+                {
+                    runs.back().second = value;
+                }
+                else
+                {
+                    runs.push_back({value, value});
+                }
+            }
+            return runs;
+        }
+        if (const auto *bitset = std::get_if<bitset_container>(&chunk))
+        {
+            return runsOfWords(bitset->words);
+        }
+        return std::get<run_container>(chunk).runs;
+    }
+
+    inline std::vector<std::uint64_t> toWords(const container &chunk)
+    {
+        if (const auto *bitset = std::get_if<bitset_container>(&chunk))
+        {
+            return bitset->words;
+        }
+        std::vector<std::uint64_t> words(wordCount, 0);
+        if (const auto *array = std::get_if<array_container>(&chunk))
+        {
+            for (std::uint16_t value: array->values)
+            {
+                words[value / 64] |= std::uint64_t(1) << (value % 64);
+            }
+            return words;
+        }
+        for (const auto &[first, last]: std::get<run_container>(chunk).runs)
+        {
+            for (std::uint32_t position = first; position <= last; )
+            {
+                const std::uint32_t bit = position % 64;
+                const std::uint32_t count = std::min<std::uint32_t>(64 - bit, last - position + 1);
+                const std::uint64_t mask = count == 64 ? ~std::uint64_t(0) : ((std::uint64_t(1) << count) - 1) << bit;
+                words[position / 64] |= mask;
+                position += count;
+            }
+        }
+        return words;
+    }
+
+    // Serialized sizes as in Roaring: run 2 + 4 per run, array 2 per value, bitset 8 KiB.
+    inline bool runsAreSmallest(std::uint32_t cardinality, std::size_t runCount)
+    {
+        const std::size_t runBytes = 2 + 4 * runCount;
+        return runBytes <= 8192 && (cardinality > arrayLimit || runBytes <= 2 * std::size_t(cardinality));
+    }
+
+    inline container fromRuns(std::vector<run> runs)
+    {
+        std::uint32_t count = 0;
+        for (const auto &[first, last]: runs)
+        {
+            count += static_cast<std::uint32_t>(last - first) + 1;
+        }
+        if (runsAreSmallest(count, runs.size()))
+        {
+            return run_container{std::move(runs)};
+        }
+        if (count <= arrayLimit)
+        {
+            array_container array;
+            array.values.reserve(count);
+            for (const auto &[first, last]: runs)
+            {
+                for (std::uint32_t value = first; value <= last; value++)
+                {
+                    array.values.push_back(static_cast<std::uint16_t>(value));
+                }
+            }
+            return array;
+        }
+        return bitset_container{toWords(run_container{std::move(runs)}), count};
+    }
+
+    inline container fromWords(std::vector<std::uint64_t> words)
+    {
+        std::uint32_t count = 0;
+        std::size_t runCount = 0;
+        std::uint64_t carry = 0; // highest bit of the previous word
+        for (std::uint64_t word: words)
+        {
+            count += static_cast<std::uint32_t>(__builtin_popcountll(word));
+            // a run starts at every set bit whose lower neighbour is clear
+            runCount += static_cast<std::size_t>(__builtin_popcountll(word & ~((word << 1) | carry)));
+            carry = word >> 63;
+        }
+        if (runsAreSmallest(count, runCount))
+        {
+            return run_container{runsOfWords(words)};
+        }
+        if (count <= arrayLimit)
+        {
+            array_container array;
+            array.values.reserve(count);
+            for (std::size_t w = 0; w < wordCount; w++)
+            {
+                for (std::uint64_t word = words[w]; word != 0; word &= word - 1)
+                {
+                    array.values.push_back(static_cast<std::uint16_t>(w * 64 + __builtin_ctzll(word)));
+                }
+            }
+            return array;
+        }
+        return bitset_container{std::move(words), count};
+    }
+
+    inline container fromArray(std::vector<std::uint16_t> values)
+    {
+        std::size_t runCount = 0;
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            runCount += i == 0 || values[i - 1] + 1 != values[i];
+        }
+        if (runsAreSmallest(static_cast<std::uint32_t>(values.size()), runCount))
+        {
+            return run_container{toRuns(array_container{std::move(values)})};
+        }
+        if (values.size() <= arrayLimit)
+        {
+            return array_container{std::move(values)};
+        }
+        return fromWords(toWords(array_container{std::move(values)}));
+    }
+
+    // Grows or shrinks [begin, end) of items to count slots in place and returns the first slot.
+    template<typename T>
+    typename std::vector<T>::iterator resizeRange(std::vector<T> &items, typename std::vector<T>::iterator begin,
+                                                  typename std::vector<T>::iterator end, std::size_t count)
+    {
+        const auto index = begin - items.begin();
+        const std::size_t replaced = static_cast<std::size_t>(end - begin);
+        if (count > replaced)
+        {
+            items.insert(end, count - replaced, T{});
+        }
+        else
+        {
+            items.erase(begin + static_cast<std::ptrdiff_t>(count), end);
+        }
+        return items.begin() + index;
+    }
+
+    // Sets [first, last] of runs to value in place.
+    inline void setRange(std::vector<run> &runs, std::uint32_t first, std::uint32_t last, bool value)
+    {
+        // [begin, end) are the runs overlapping or adjacent to the range
+        const auto begin = std::lower_bound(runs.begin(), runs.end(), first,
+                                            [](const run &r, std::uint32_t key) { return std::uint32_t(r.second) + 1 < key; });
+        const auto end = std::upper_bound(begin, runs.end(), last + 1,
+                                          [](std::uint32_t key, const run &r) { return key < r.first; });
+        run pieces[2];
+        std::size_t count = 0;
+        if (value)
+        {
+            pieces[count++] = {static_cast<std::uint16_t>(begin != end ? std::min<std::uint32_t>(first, begin->first) : first),
+                               static_cast<std::uint16_t>(begin != end ? std::max<std::uint32_t>(last, std::prev(end)->second) : last)};
+        }
+        else if (begin != end)
+        {
+            if (begin->first < first)
+            {
+                pieces[count++] = {begin->first, static_cast<std::uint16_t>(first - 1)};
+            }
+            if (std::prev(end)->second > last)
+            {
+                pieces[count++] = {static_cast<std::uint16_t>(last + 1), std::prev(end)->second};
+            }
+        }
+        std::copy(pieces, pieces + count, resizeRange(runs, begin, end, count));
+    }
+
+    // Sets [first, last] of chunk to value, changing its container in place unless a threshold
+    // is crossed, see bitmap_interval_map.
+    inline void setRange(container &chunk, std::uint32_t first, std::uint32_t last, bool value)
+    {
+        if (auto *array = std::get_if<array_container>(&chunk))
+        {
+            auto &values = array->values;
+            const auto begin = std::lower_bound(values.begin(), values.end(), first);
+            const auto end = std::upper_bound(begin, values.end(), last);
+            if (!value)
+            {
+                values.erase(begin, end);
+                return;
+            }
+            const std::size_t count = last - first + 1;
+            if (values.size() - static_cast<std::size_t>(end - begin) + count > arrayLimit)
+            {
+                auto runs = toRuns(chunk);
+                setRange(runs, first, last, value);
+                chunk = fromRuns(std::move(runs));
+                return;
+            }
+            const auto slots = resizeRange(values, begin, end, count);
+            std::iota(slots, slots + static_cast<std::ptrdiff_t>(count), static_cast<std::uint16_t>(first));
+            return;
+        }
+        if (auto *bitset = std::get_if<bitset_container>(&chunk))
+        {
+            for (std::uint32_t position = first; position <= last; )
+            {
+                const std::uint32_t bit = position % 64;
+                const std::uint32_t count = std::min<std::uint32_t>(64 - bit, last - position + 1);
+                const std::uint64_t mask = count == 64 ? ~std::uint64_t(0) : ((std::uint64_t(1) << count) - 1) << bit;
+                std::uint64_t &word = bitset->words[position / 64];
+                const std::uint64_t changed = value ? mask & ~word : mask & word;
+                word ^= changed;
+                const auto flipped = static_cast<std::uint32_t>(__builtin_popcountll(changed));
+                bitset->cardinality = value ? bitset->cardinality + flipped : bitset->cardinality - flipped;
+                position += count;
+            }
+            if (bitset->cardinality <= arrayLimit || bitset->cardinality == chunkSize)
+            {
+                chunk = fromWords(std::move(bitset->words));
+            }
+            return;
+        }
+        auto &runs = std::get<run_container>(chunk).runs;
+        setRange(runs, first, last, value);
+        if (2 + 4 * runs.size() > 8192)
+        {
+            chunk = fromRuns(std::move(runs));
+        }
+    }
+
+    // Sweep over the sorted toggle points of both run lists.
+    inline std::vector<run> combineRuns(const std::vector<run> &a, const std::vector<run> &b, set_operation operation)
+    {
+        std::vector<run> result;
+        std::size_t ia = 0;
+        std::size_t ib = 0;
+        bool inA = false;
+        bool inB = false;
+        bool inResult = false;
+        std::uint32_t resultFirst = 0;
+        auto nextToggle = [](const std::vector<run> &runs, std::size_t index, bool inside)
+        {
+            if (index >= runs.size())
+            {
+                return chunkSize;
+            }
+            return inside ? std::uint32_t(runs[index].second) + 1 : std::uint32_t(runs[index].first);
+        };
+
+        for (;;)
+        {
+            const std::uint32_t toggleA = nextToggle(a, ia, inA);
+            const std::uint32_t toggleB = nextToggle(b, ib, inB);
+            const std::uint32_t position = std::min(toggleA, toggleB);
+            if (position >= chunkSize)
+            {
+                break;
+            }
+            if (toggleA == position)
+            {
+                ia += inA;
+                inA = !inA;
+            }
+            if (toggleB == position)
+            {
+                ib += inB;
+                inB = !inB;
+            }
+            const bool inside = apply(operation, inA, inB);
+            if (inside && !inResult)
+            {
+                resultFirst = position;
+            }
+            else if (!inside && inResult)
+            {
+                result.push_back({static_cast<std::uint16_t>(resultFirst), static_cast<std::uint16_t>(position - 1)});
+            }
+            inResult = inside;
+        }
+        if (inResult)
+        {
+            result.push_back({static_cast<std::uint16_t>(resultFirst), 0xFFFF});
+        }
+        return result;
+    }
+
+    inline container combine(const container &a, const container &b, set_operation operation)
+    {
+        const auto *arrayA = std::get_if<array_container>(&a);
+        const auto *arrayB = std::get_if<array_container>(&b);
+        if (arrayA && arrayB)
+        {
+            std::vector<std::uint16_t> values;
+            const auto &va = arrayA->values;
+            const auto &vb = arrayB->values;
+            switch (operation)
+            {
+                case set_operation::intersection:
+                    std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(values));
+                    break;
+                case set_operation::join:
+                    std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(values));
+                    break;
+                default:
+                    std::set_symmetric_difference(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(values));
+                    break;
+            }
+            return fromArray(std::move(values));
+        }
+        if (operation == set_operation::intersection && (arrayA || arrayB))
+        {
+            const auto &array = arrayA ? *arrayA : *arrayB;
+            const auto &other = arrayA ? b : a;
+            std::vector<std::uint16_t> values;
+            std::copy_if(array.values.begin(), array.values.end(), std::back_inserter(values),
+                         [&other](std::uint16_t value) { return contains(other, value); });
+            return fromArray(std::move(values));
+        }
+        if (std::holds_alternative<run_container>(a) && std::holds_alternative<run_container>(b))
+        {
+            return fromRuns(combineRuns(std::get<run_container>(a).runs, std::get<run_container>(b).runs, operation));
+        }
+
+        auto words = toWords(a);
+        const auto other = toWords(b);
+        for (std::size_t w = 0; w < wordCount; w++)
+        {
+            words[w] = apply(operation, words[w], other[w]);
+        }
+        return fromWords(std::move(words));
+    }
+
+    // Returns true if all keys of the chunk have value, in O(1).
+    inline bool isUniform(const container &chunk, bool value)
+    {
+        if (const auto *runContainer = std::get_if<run_container>(&chunk))
+        {
+            const auto &runs = runContainer->runs;
+            return value ? runs.size() == 1 && runs.front() == run{0, 0xFFFF} : runs.empty();
+        }
+        return cardinality(chunk) == (value ? chunkSize : 0);
+    }
+}
+
+
+class bitmap_interval_map
+{
+public:
+    explicit bitmap_interval_map(bool value)
+        : m_default(value)
+    { }
+
+    // Same contract as interval_map::assign.
+    void assign(std::uint32_t keyBegin, std::uint32_t keyEnd, bool val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        const std::uint32_t keyLast = keyEnd - 1;
+        const std::uint32_t chunkBegin = keyBegin >> 16;
+        const std::uint32_t chunkLast = keyLast >> 16;
+
+        if (chunkBegin == chunkLast)
+        {
+            setInChunk(chunkBegin, keyBegin & 0xFFFF, keyLast & 0xFFFF, val);
+            return;
+        }
+
+        setInChunk(chunkBegin, keyBegin & 0xFFFF, 0xFFFF, val);
+        setInChunk(chunkLast, 0, keyLast & 0xFFFF, val);
+
+        // chunks strictly between become uniform
+        auto first = findChunk(chunkBegin + 1);
+        auto last = findChunk(chunkLast);
+        first = m_chunks.erase(first, last);
+        if (val != m_default)
+        {
+            std::vector<chunk_entry> full;
+            full.reserve(chunkLast - chunkBegin - 1);
+            for (std::uint32_t chunk = chunkBegin + 1; chunk < chunkLast; chunk++)
+            {
+                full.push_back({chunk, detail::bitmap::uniform(val)});
+            }
+            m_chunks.insert(first, std::make_move_iterator(full.begin()), std::make_move_iterator(full.end()));
+        }
+    }
+
+    bool operator[](std::uint32_t key) const
+    {
+        auto it = findChunk(key >> 16);
+        if (it == m_chunks.end() || it->chunk != key >> 16)
+        {
+            return m_default;
+        }
+        return detail::bitmap::contains(it->container, static_cast<std::uint16_t>(key & 0xFFFF));
+    }
+
+    bitmap_interval_map &operator&=(const bitmap_interval_map &other)
+    {
+        return *this = combine(*this, other, detail::bitmap::set_operation::intersection);
+    }
+
+    bitmap_interval_map &operator|=(const bitmap_interval_map &other)
+    {
+        return *this = combine(*this, other, detail::bitmap::set_operation::join);
+    }
+
+    bitmap_interval_map &operator^=(const bitmap_interval_map &other)
+    {
+        return *this = combine(*this, other, detail::bitmap::set_operation::difference);
+    }
+
+    friend bitmap_interval_map operator&(const bitmap_interval_map &a, const bitmap_interval_map &b)
+    {
+        return combine(a, b, detail::bitmap::set_operation::intersection);
+    }
+
+    friend bitmap_interval_map operator|(const bitmap_interval_map &a, const bitmap_interval_map &b)
+    {
+        return combine(a, b, detail::bitmap::set_operation::join);
+    }
+
+    friend bitmap_interval_map operator^(const bitmap_interval_map &a, const bitmap_interval_map &b)
+    {
+        return combine(a, b, detail::bitmap::set_operation::difference);
+    }
+
+    // Number of chunks that differ from the default value.
+    std::size_t chunkCount() const
+    {
+        return m_chunks.size();
+    }
+
+    // Calls fn(key, value) for every boundary the canonical interval_map<std::uint32_t, bool> would hold.
+    template<typename Fn>
+    void forEachBoundary(Fn fn) const
+    {
+        bool current = m_default;
+        auto emit = [&](std::uint64_t key, bool value)
+        {
+            if (value != current)
+            {
+                fn(static_cast<std::uint32_t>(key), value);
+                current = value;
+            }
+        };
+
+        std::uint64_t position = 0;
+        for (const auto &entry: m_chunks)
+        {
+            const std::uint64_t base = std::uint64_t(entry.chunk) << 16;
+            if (position < base)
+            {
+                emit(position, m_default);
+            }
+            std::uint64_t cursor = base;
+            const auto *runContainer = std::get_if<detail::bitmap::run_container>(&entry.container);
+            const auto converted = runContainer ? std::vector<detail::bitmap::run>{} : detail::bitmap::toRuns(entry.container);
+            for (const auto &[first, last]: runContainer ? runContainer->runs : converted)
+            {
+                if (cursor < base + first)
+                {
+                    emit(cursor, false);
+                }
+                emit(base + first, true);
+                cursor = base + last + 1;
+            }
+            if (cursor < base + detail::bitmap::chunkSize)
+            {
+                emit(cursor, false);
+            }
+            position = base + detail::bitmap::chunkSize;
+        }
+        if (position < (std::uint64_t(1) << 32))
+        {
+            emit(position, m_default);
+        }
+    }
+
+    // Same output as interval_map<std::uint32_t, bool>::getMapSnippet.
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        forEachBoundary([&out](std::uint32_t key, bool value)
+        {
+            out = detail::writeBoundary(out, key, value);
+        });
+        return result;
+    }
+
+private:
+    struct chunk_entry
+    {
+        std::uint32_t chunk;
+        detail::bitmap::container container;
+    };
+
+    std::vector<chunk_entry>::iterator findChunk(std::uint32_t chunk)
+    {
+        return std::lower_bound(m_chunks.begin(), m_chunks.end(), chunk,
+                                [](const chunk_entry &entry, std::uint32_t key) { return entry.chunk < key; });
+    }
+
+    std::vector<chunk_entry>::const_iterator findChunk(std::uint32_t chunk) const
+    {
+        return std::lower_bound(m_chunks.begin(), m_chunks.end(), chunk,
+                                [](const chunk_entry &entry, std::uint32_t key) { return entry.chunk < key; });
+    }
+
+    void setInChunk(std::uint32_t chunk, std::uint32_t first, std::uint32_t last, bool value)
+    {
+        auto it = findChunk(chunk);
+        if (it == m_chunks.end() || it->chunk != chunk)
+        {
+            if (value == m_default)
+            {
+                return;
+            }
+            it = m_chunks.insert(it, {chunk, detail::bitmap::uniform(m_default)});
+        }
+        detail::bitmap::setRange(it->container, first, last, value);
+        if (detail::bitmap::isUniform(it->container, m_default))
+        {
+            m_chunks.erase(it);
+        }
+    }
+
+    static bitmap_interval_map combine(const bitmap_interval_map &a, const bitmap_interval_map &b, detail::bitmap::set_operation operation)
+    {
+        using namespace detail::bitmap;
+        bitmap_interval_map result{apply(operation, a.m_default, b.m_default)};
+
+        auto add = [&result](std::uint32_t chunk, container merged)
+        {
+            if (!isUniform(merged, result.m_default))
+            {
+                result.m_chunks.push_back({chunk, std::move(merged)});
+            }
+        };
+
+        // a chunk missing on one side is uniform with that side's default
+        const container defaultA = uniform(a.m_default);
+        const container defaultB = uniform(b.m_default);
+        auto ia = a.m_chunks.begin();
+        auto ib = b.m_chunks.begin();
+        while (ia != a.m_chunks.end() || ib != b.m_chunks.end())
+        {
+            if (ib == b.m_chunks.end() || (ia != a.m_chunks.end() && ia->chunk < ib->chunk))
+            {
+                add(ia->chunk, detail::bitmap::combine(ia->container, defaultB, operation));
+                ++ia;
+            }
+            else if (ia == a.m_chunks.end() || ib->chunk < ia->chunk)
+            {
+                add(ib->chunk, detail::bitmap::combine(defaultA, ib->container, operation));
+                ++ib;
+            }
+            else
+            {
+                add(ia->chunk, detail::bitmap::combine(ia->container, ib->container, operation));
+                ++ia;
+                ++ib;
+            }
+        }
+        return result;
+    }
+
+    bool m_default;   // value of every chunk missing from m_chunks, also the value before the first boundary
+    std::vector<chunk_entry> m_chunks;
+};
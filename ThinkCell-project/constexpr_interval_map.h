@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "interval_map.h"
+
+
+/*
+    interval_map with the same assign() semantics in two fixed arrays of at most N boundaries,
+    usable in constant expressions: a table built by assigns inside a constexpr function or lambda
+    is computed by the compiler and ends up as constant data, so it costs nothing at startup,
+    allocates nothing and its lookups can be inlined and folded.
+
+        constexpr auto digits = []
+        {
+            constexpr_interval_map<char, bool, 2> map{false};
+            map.assign('0', '9' + 1, true);
+            return map;
+        }();
+        static_assert(digits['5'] && !digits['a']);
+
+    K and V must be literal types with default constructors, and for compile-time use their
+    operator< and operator== must be constexpr. assign() shifts the array, O(N), which is meant
+    for tables built once; lookups are a binary search. An assign that would need more than N
+    boundaries throws std::length_error, which makes a constant evaluation fail to compile.
+*/
+template<typename K, typename V, std::size_t N>
+class constexpr_interval_map
+{
+    static_assert(N > 0, "constexpr_interval_map needs room for at least one boundary");
+
+public:
+    constexpr explicit constexpr_interval_map(const V &value)
+        : m_valBegin(value)
+    { }
+
+    // Same contract as interval_map::assign.
+    constexpr void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        std::size_t first = 0;
+        while (first < m_size && m_keys[first] < keyBegin)
+        {
+            first++;
+        }
+        std::size_t last = first;
+        while (last < m_size && m_keys[last] < keyEnd)
+        {
+            last++;
+        }
+        // [first, last) are the boundaries inside [keyBegin, keyEnd)
+
+        // the boundaries [first, replaceEnd) are replaced by the count entries of newKeys / newValues
+        K newKeys[2] = {};
+        V newValues[2] = {};
+        std::size_t count = 0;
+        const V &before = first == 0 ? m_valBegin : m_values[first - 1];
+        if (!(before == val))
+        {
+            newKeys[count] = keyBegin;
+            newValues[count] = val;
+            count++;
+        }
+        std::size_t replaceEnd = last;
+        if (last < m_size && !(keyEnd < m_keys[last]))
+        {
+            // a boundary at keyEnd exists already, it may now repeat val
+            if (m_values[last] == val)
+            {
+                replaceEnd = last + 1;
+            }
+        }
+        else
+        {
+            const V &current = last > first ? m_values[last - 1] : before;
+            if (!(current == val))
+            {
+                newKeys[count] = keyEnd;
+                newValues[count] = current;
+                count++;
+            }
+        }
+
+        const std::size_t newSize = m_size - (replaceEnd - first) + count;
+        if (newSize > N)
+        {
+            throw std::length_error("constexpr_interval_map capacity exceeded");
+        }
+        moveTail(replaceEnd, first + count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            m_keys[first + i] = newKeys[i];
+            m_values[first + i] = newValues[i];
+        }
+        m_size = newSize;
+    }
+
+    constexpr const V &operator[](const K &key) const
+    {
+        const std::size_t position = upperBound(key);
+        return position == 0 ? m_valBegin : m_values[position - 1];
+    }
+
+    // Number of boundaries whose key is not greater than key.
+    constexpr std::size_t upperBound(const K &key) const
+    {
+        std::size_t low = 0;
+        std::size_t high = m_size;
+        while (low < high)
+        {
+            const std::size_t middle = low + (high - low) / 2;
+            if (key < m_keys[middle])
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        return low;
+    }
+
+    constexpr const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return m_size;
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return N;
+    }
+
+    constexpr const K &key(std::size_t index) const
+    {
+        return m_keys[index];
+    }
+
+    constexpr const V &value(std::size_t index) const
+    {
+        return m_values[index];
+    }
+
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        for (std::size_t i = 0; i < m_size; i++)
+        {
+            out = detail::writeBoundary(out, m_keys[i], m_values[i]);
+        }
+        return result;
+    }
+
+private:
+    // Moves the boundaries [from, m_size) so that they start at to.
+    constexpr void moveTail(std::size_t from, std::size_t to)
+    {
+        if (to < from)
+        {
+            for (std::size_t i = from; i < m_size; i++)
+            {
+                m_keys[i - from + to] = m_keys[i];
+                m_values[i - from + to] = m_values[i];
+            }
+        }
+        else if (from < to)
+        {
+            for (std::size_t i = m_size; i > from; i--)
+            {
+                m_keys[i - 1 - from + to] = m_keys[i - 1];
+                m_values[i - 1 - from + to] = m_values[i - 1];
+            }
+        }
+    }
+
+    V m_valBegin;
+    K m_keys[N] = {};
+    V m_values[N] = {};
+    std::size_t m_size = 0;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "interval_map.h"
+
+
+/*
+    Copy-on-write handle to an interval_map.
+
+    Copies share one interval_map through a reference count, so handing a snapshot to another task
+    is O(1) and read-only consumers never copy anything. The first assign() on a handle that still
+    shares its map clones it; a std::map cannot share part of its nodes, so the clone is a full
+    copy. radix_interval_map shares its nodes itself and only clones the path it modifies.
+
+    Handles may be used from different threads; a single handle may not.
+*/
+template<typename K, typename V>
+class cow_interval_map
+{
+public:
+    explicit cow_interval_map(const V &value)
+        : m_map(std::make_shared<interval_map<K, V>>(value))
+    { }
+
+    explicit cow_interval_map(interval_map<K, V> map)
+        : m_map(std::make_shared<interval_map<K, V>>(std::move(map)))
+    { }
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        writable().assign(keyBegin, keyEnd, val);
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return (*m_map)[key];
+    }
+
+    const interval_map<K, V> &get() const
+    {
+        return *m_map;
+    }
+
+    // Whether another handle uses the same map, i.e. whether the next assign() copies it.
+    bool shared() const
+    {
+        return m_map.use_count() > 1;
+    }
+
+    const V &getValBegin() const
+    {
+        return m_map->getValBegin();
+    }
+
+    auto begin() const
+    {
+        return m_map->begin();
+    }
+
+    auto end() const
+    {
+        return m_map->end();
+    }
+
+    std::size_t size() const
+    {
+        return m_map->size();
+    }
+
+    bool empty() const
+    {
+        return m_map->empty();
+    }
+
+    std::string getMapSnippet() const
+    {
+        return m_map->getMapSnippet();
+    }
+
+    std::string getValueSlice(const K &keyBegin, const K &keyEnd) const
+    {
+        return m_map->getValueSlice(keyBegin, keyEnd);
+    }
+
+private:
+    interval_map<K, V> &writable()
+    {
+        if (m_map.use_count() > 1)
+        {
+            m_map = std::make_shared<interval_map<K, V>>(*m_map);
+        }
+        else
+        {
+            // pairs with the release decrement of the handles that let go of the map
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *m_map;
+    }
+
+    std::shared_ptr<interval_map<K, V>> m_map;
+};
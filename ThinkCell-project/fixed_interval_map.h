@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+#include "inline_boundaries.h"
+#include "interval_map.h"
+
+
+/*
+    interval_map with the same semantics that keeps at most N boundaries inline and never touches
+    the heap, for real-time threads that must not allocate.
+
+    assign() works out the canonical result first and, if it would need more than N boundaries,
+    leaves the map unchanged and returns false; nothing is thrown. Both assign() and lookups scan
+    the N slots at most a constant number of times, so their worst case is O(N) operations on K
+    and V regardless of the history of the map. That bound only holds if copying, moving and
+    comparing K and V is itself bounded and allocation-free, e.g. for arithmetic types.
+
+    Unlike small_interval_map it does not fall back to an interval_map when full.
+*/
+template<typename K, typename V, std::size_t N>
+class fixed_interval_map
+{
+public:
+    explicit fixed_interval_map(const V &value)
+        : m_valBegin(value)
+    { }
+
+    // Same contract as interval_map::assign, except that an assign that does not fit into N
+    // boundaries changes nothing and returns false. Empty ranges succeed.
+    [[nodiscard]] bool assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return true;
+        }
+        const auto plan = m_boundaries.planAssign(keyBegin, keyEnd, val, m_valBegin);
+        if (plan.newSize > N)
+        {
+            return false;
+        }
+        m_boundaries.applyAssign(plan, keyBegin, keyEnd, val, m_valBegin);
+        return true;
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return m_boundaries.lookup(key, m_valBegin);
+    }
+
+    const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    std::size_t size() const
+    {
+        return m_boundaries.size();
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return N;
+    }
+
+    const K &key(std::size_t index) const
+    {
+        return m_boundaries.key(index);
+    }
+
+    const V &value(std::size_t index) const
+    {
+        return m_boundaries.value(index);
+    }
+
+    // Allocates the result; meant for tests and diagnostics, not for the real-time path.
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        for (std::size_t i = 0; i < m_boundaries.size(); i++)
+        {
+            out = detail::writeBoundary(out, m_boundaries.key(i), m_boundaries.value(i));
+        }
+        return result;
+    }
+
+private:
+    V m_valBegin;
+    detail::inline_boundaries<K, V, N> m_boundaries;
+};
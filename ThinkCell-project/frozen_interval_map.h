@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "batch_search.h"
+#include "interval_map.h"
+
+
+/*
+    Read-only snapshot of an interval map in two contiguous arrays.
+
+    m_keys holds the boundaries in order; m_values[0] is the value before the first boundary and
+    m_values[i + 1] belongs to m_keys[i], so a lookup is one upper_bound over m_keys without any
+    special case. Built in O(N) from any map that offers getValBegin() and in-order (key, value)
+    iteration, e.g. interval_map.
+*/
+template<typename K, typename V>
+class frozen_interval_map
+{
+public:
+    template<typename Map>
+    explicit frozen_interval_map(const Map &map)
+    {
+        m_values.push_back(map.getValBegin());
+        for (const auto &[key, value]: map)
+        {
+            m_keys.push_back(key);
+            m_values.push_back(value);
+        }
+    }
+
+    // Builds the snapshot from (key, value) boundaries given in strictly increasing key order.
+    // Entries that repeat the value in effect before them are skipped.
+    template<typename InputIt>
+    frozen_interval_map(const V &value, InputIt first, InputIt last)
+    {
+        m_values.push_back(value);
+        for (; first != last; ++first)
+        {
+            const auto &[key, val] = *first;
+            if (!(val == m_values.back()))
+            {
+                m_keys.push_back(key);
+                m_values.push_back(val);
+            }
+        }
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return m_values[detail::branchlessUpperBound(m_keys.data(), m_keys.size(), key)];
+    }
+
+    // Writes (*this)[*it] to out[it - first] for every key in [first, last), overlapping the
+    // memory latency of many searches; both iterators must be random access.
+    template<typename KeyIt, typename OutIt>
+    void lookupBatch(KeyIt first, KeyIt last, OutIt out) const
+    {
+        detail::batchUpperBound(m_keys.data(), m_keys.size(), first, last, [&](std::size_t index, std::size_t position)
+        {
+            out[index] = m_values[position];
+        });
+    }
+
+    const V &getValBegin() const
+    {
+        return m_values.front();
+    }
+
+    std::size_t size() const
+    {
+        return m_keys.size();
+    }
+
+    const std::vector<K> &keys() const
+    {
+        return m_keys;
+    }
+
+    // values()[0] is the value before the first key, values()[i + 1] belongs to keys()[i].
+    const std::vector<V> &values() const
+    {
+        return m_values;
+    }
+
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        for (std::size_t i = 0; i < m_keys.size(); i++)
+        {
+            out = detail::writeBoundary(out, m_keys[i], m_values[i + 1]);
+        }
+        return result;
+    }
+
+private:
+    std::vector<K> m_keys;
+    std::vector<V> m_values;
+};
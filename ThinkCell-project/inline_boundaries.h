@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+
+namespace detail
+{
+    /*
+        Up to N interval_map boundaries stored in place: keys and values in two separate arrays so
+        that the key scan touches only keys. Slots [0, size()) hold live objects, the rest is raw
+        storage, hence K and V need no default constructor.
+
+        The value associated with keys before the first boundary is kept by the owner and passed in.
+    */
+    template<typename K, typename V, std::size_t N>
+    class inline_boundaries
+    {
+        static_assert(N > 0, "inline_boundaries needs room for at least one boundary");
+
+    public:
+        // What assign(keyBegin, keyEnd, val) has to change, see planAssign().
+        struct assign_plan
+        {
+            std::size_t first;    // first boundary not less than keyBegin
+            std::size_t last;     // first boundary not less than keyEnd
+            bool insertBegin;     // a boundary at keyBegin is needed
+            bool insertEnd;       // a boundary at keyEnd is needed and none exists yet
+            bool dropEnd;         // the existing boundary at keyEnd becomes redundant
+            std::size_t newSize;
+        };
+
+        inline_boundaries() = default;
+
+        inline_boundaries(const inline_boundaries &other)
+        {
+            for (; m_size < other.m_size; m_size++)
+            {
+                new (keySlot(m_size)) K(other.key(m_size));
+                new (valueSlot(m_size)) V(other.value(m_size));
+            }
+        }
+
+        inline_boundaries &operator=(const inline_boundaries &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (; m_size < other.m_size; m_size++)
+                {
+                    new (keySlot(m_size)) K(other.key(m_size));
+                    new (valueSlot(m_size)) V(other.value(m_size));
+                }
+            }
+            return *this;
+        }
+
+        ~inline_boundaries()
+        {
+            clear();
+        }
+
+        static constexpr std::size_t capacity()
+        {
+            return N;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        const K &key(std::size_t index) const
+        {
+            return keys()[index];
+        }
+
+        const V &value(std::size_t index) const
+        {
+            return values()[index];
+        }
+
+        // Number of boundaries whose key is not greater than key, i.e. upper_bound as an index.
+        // Counting without an early exit keeps the loop branch free, so it vectorizes for
+        // arithmetic keys.
+        std::size_t upperBound(const K &key) const
+        {
+            const K *allKeys = keys();
+            std::size_t position = 0;
+            for (std::size_t i = 0; i < m_size; i++)
+            {
+                position += !(key < allKeys[i]);
+            }
+            return position;
+        }
+
+        const V &lookup(const K &key, const V &valBegin) const
+        {
+            const std::size_t position = upperBound(key);
+            return position == 0 ? valBegin : value(position - 1);
+        }
+
+        // Works out the canonical result of assigning val to [keyBegin, keyEnd) without changing
+        // anything, so callers can check newSize against the capacity first.
+        // Requires keyBegin < keyEnd.
+        assign_plan planAssign(const K &keyBegin, const K &keyEnd, const V &val, const V &valBegin) const
+        {
+            const K *allKeys = keys();
+            assign_plan plan{};
+            plan.first = 0;
+            plan.last = 0;
+            for (std::size_t i = 0; i < m_size; i++)
+            {
+                plan.first += allKeys[i] < keyBegin;
+                plan.last += allKeys[i] < keyEnd;
+            }
+
+            const V &before = plan.first == 0 ? valBegin : value(plan.first - 1);
+            if (plan.last == m_size || keyEnd < allKeys[plan.last])
+            {
+                const V &current = plan.last > plan.first ? value(plan.last - 1) : before;
+                plan.insertEnd = !(current == val);
+            }
+            else
+            {
+                plan.dropEnd = value(plan.last) == val;
+            }
+            plan.insertBegin = !(before == val);
+
+            plan.newSize = m_size - (plan.last - plan.first) - plan.dropEnd + plan.insertBegin + plan.insertEnd;
+            return plan;
+        }
+
+        // Carries out a plan made by planAssign() with the same arguments; newSize must fit.
+        void applyAssign(const assign_plan &plan, const K &keyBegin, const K &keyEnd, const V &val, const V &valBegin)
+        {
+            std::size_t eraseBegin = plan.first;
+            std::size_t eraseEnd = plan.last;
+
+            if (plan.insertEnd)
+            {
+                if (plan.last > plan.first)
+                {
+                    // the last boundary inside the range holds the value for keyEnd, just move it
+                    keys()[plan.last - 1] = keyEnd;
+                    eraseEnd = plan.last - 1;
+                }
+                else
+                {
+                    insertAt(plan.last, keyEnd, plan.first == 0 ? valBegin : value(plan.first - 1));
+                }
+            }
+            else if (plan.dropEnd)
+            {
+                eraseEnd = plan.last + 1;
+            }
+
+            if (plan.insertBegin)
+            {
+                if (eraseBegin < eraseEnd)
+                {
+                    keys()[eraseBegin] = keyBegin;
+                    values()[eraseBegin] = val;
+                    eraseBegin++;
+                }
+                else
+                {
+                    insertAt(eraseBegin, keyBegin, val);
+                }
+            }
+            eraseRange(eraseBegin, eraseEnd);
+        }
+
+        void clear()
+        {
+            while (m_size > 0)
+            {
+                m_size--;
+                keys()[m_size].~K();
+                values()[m_size].~V();
+            }
+        }
+
+    private:
+        K *keys()
+        {
+            return std::launder(reinterpret_cast<K *>(m_keys));
+        }
+
+        const K *keys() const
+        {
+            return std::launder(reinterpret_cast<const K *>(m_keys));
+        }
+
+        V *values()
+        {
+            return std::launder(reinterpret_cast<V *>(m_values));
+        }
+
+        const V *values() const
+        {
+            return std::launder(reinterpret_cast<const V *>(m_values));
+        }
+
+        void *keySlot(std::size_t index)
+        {
+            return m_keys + index * sizeof(K);
+        }
+
+        void *valueSlot(std::size_t index)
+        {
+            return m_values + index * sizeof(V);
+        }
+
+        // Inserts before index; value may refer to a slot below index.
+        void insertAt(std::size_t index, const K &key, const V &value)
+        {
+            if (index == m_size)
+            {
+                new (keySlot(m_size)) K(key);
+                new (valueSlot(m_size)) V(value);
+            }
+            else
+            {
+                new (keySlot(m_size)) K(std::move(keys()[m_size - 1]));
+                new (valueSlot(m_size)) V(std::move(values()[m_size - 1]));
+                for (std::size_t i = m_size - 1; i > index; i--)
+                {
+                    keys()[i] = std::move(keys()[i - 1]);
+                    values()[i] = std::move(values()[i - 1]);
+                }
+                keys()[index] = key;
+                values()[index] = value;
+            }
+            m_size++;
+        }
+
+        void eraseRange(std::size_t first, std::size_t last)
+        {
+            if (first == last)
+            {
+                return;
+            }
+            std::size_t target = first;
+            for (std::size_t i = last; i < m_size; i++, target++)
+            {
+                keys()[target] = std::move(keys()[i]);
+                values()[target] = std::move(values()[i]);
+            }
+            while (m_size > target)
+            {
+                m_size--;
+                keys()[m_size].~K();
+                values()[m_size].~V();
+            }
+        }
+
+        alignas(K) unsigned char m_keys[N * sizeof(K)];
+        alignas(V) unsigned char m_values[N * sizeof(V)];
+        std::size_t m_size = 0;
+    };
+}
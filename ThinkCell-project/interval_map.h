@@ -0,0 +1,1013 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace detail
+{
+    // Types written by formatValue() without going through an ostream.
+    template<typename T>
+    constexpr bool isCharLike = std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>;
+
+    template<typename T>
+    constexpr bool isFastFormattable = std::is_same_v<T, bool> || isCharLike<T>
+        || std::is_floating_point_v<T>
+        || (std::is_integral_v<T> && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>);
+
+    // Upper bound of characters formatValue() writes for a fast formattable T.
+    template<typename T>
+    constexpr std::size_t maxFormattedSize()
+    {
+        if constexpr (std::is_same_v<T, bool> || isCharLike<T>)
+        {
+            return 1;
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            // "%.6g": sign, 6 digits, point, exponent with sign and up to 5 digits
+            return 16;
+        }
+        else
+        {
+            return std::numeric_limits<T>::digits10 + 2;
+        }
+    }
+
+    // Writes value into out exactly as `std::ostream << value` with default flags would,
+    // but without locale lookups or temporary strings for arithmetic types.
+    template<typename T, typename OutputIt>
+    OutputIt formatValue(OutputIt out, const T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            *out++ = value ? '1' : '0';
+            return out;
+        }
+        else if constexpr (isCharLike<T>)
+        {
+            *out++ = static_cast<char>(value);
+            return out;
+        }
+        else if constexpr (isFastFormattable<T>)
+        {
+            char buffer[maxFormattedSize<T>()];
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                result = std::to_chars(std::begin(buffer), std::end(buffer), value, std::chars_format::general, 6);
+            }
+            else
+            {
+                result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            }
+            return std::copy(std::begin(buffer), result.ptr, out);
+        }
+        else
+        {
+            std::ostringstream stream;
+            stream << value;
+            const std::string text = stream.str();
+            return std::copy(text.begin(), text.end(), out);
+        }
+    }
+
+    template<typename OutputIt>
+    OutputIt formatLiteral(OutputIt out, const char *text)
+    {
+        while (*text)
+        {
+            *out++ = *text++;
+        }
+        return out;
+    }
+
+    // Writes the boundary (key, value) as "[key, value]", the format of every getMapSnippet().
+    template<typename OutputIt, typename K, typename V>
+    OutputIt writeBoundary(OutputIt out, const K &key, const V &value)
+    {
+        *out++ = '[';
+        out = formatValue(out, key);
+        out = formatLiteral(out, ", ");
+        out = formatValue(out, value);
+        *out++ = ']';
+        return out;
+    }
+
+    // Distance from first to key as a double; key must not be less than first. Integral keys are
+    // subtracted in their unsigned type so that the difference itself is exact.
+    template<typename K>
+    double keyDistance(const K &first, const K &key)
+    {
+        if constexpr (std::is_integral_v<K>)
+        {
+            using unsigned_type = std::make_unsigned_t<K>;
+            return static_cast<double>(static_cast<unsigned_type>(static_cast<unsigned_type>(key) - static_cast<unsigned_type>(first)));
+        }
+        else
+        {
+            return static_cast<double>(key - first);
+        }
+    }
+
+    // to + (key - from), wrapping around like unsigned arithmetic for integral keys.
+    template<typename K>
+    K translateKey(const K &key, const K &from, const K &to)
+    {
+        if constexpr (std::is_integral_v<K>)
+        {
+            using unsigned_type = std::make_unsigned_t<K>;
+            const auto offset = static_cast<unsigned_type>(static_cast<unsigned_type>(key) - static_cast<unsigned_type>(from));
+            return static_cast<K>(static_cast<unsigned_type>(static_cast<unsigned_type>(to) + offset));
+        }
+        else
+        {
+            return static_cast<K>(to + (key - from));
+        }
+    }
+
+    // Start of bucket index when [keyBegin, keyEnd) is split into count buckets of (almost) equal size.
+    template<typename K>
+    K bucketStart(const K &keyBegin, const K &keyEnd, std::size_t index, std::size_t count)
+    {
+        if constexpr (std::is_integral_v<K>)
+        {
+            // keyBegin + span * index / count without overflowing
+            using unsigned_type = std::make_unsigned_t<K>;
+            const auto span = static_cast<unsigned_type>(static_cast<unsigned_type>(keyEnd) - static_cast<unsigned_type>(keyBegin));
+            const auto offset = static_cast<unsigned_type>(span / count * index + static_cast<unsigned long long>(span % count) * index / count);
+            return static_cast<K>(static_cast<unsigned_type>(static_cast<unsigned_type>(keyBegin) + offset));
+        }
+        else
+        {
+            return index == count ? keyEnd : static_cast<K>(keyBegin + (keyEnd - keyBegin) * static_cast<K>(index) / static_cast<K>(count));
+        }
+    }
+
+    template<typename Allocator, typename = void>
+    constexpr bool hasFreshArena = false;
+
+    template<typename Allocator>
+    constexpr bool hasFreshArena<Allocator, std::void_t<decltype(std::declval<const Allocator &>().fresh(std::size_t()))>> = true;
+
+    // Allocator for a rebuilt container of size elements: one with a new arena if the allocator
+    // supports that (see node_arena_allocator), otherwise a copy.
+    template<typename Allocator>
+    Allocator freshAllocator(const Allocator &allocator, std::size_t size)
+    {
+        if constexpr (hasFreshArena<Allocator>)
+        {
+            return allocator.fresh(size);
+        }
+        else
+        {
+            return allocator;
+        }
+    }
+}
+
+
+// How interval_map::rasterize() reduces the keys of one bucket to a single value.
+enum class raster_policy
+{
+    start,      // the value of the first key of the bucket
+    last,       // the value of the last segment that reaches into the bucket
+    majority    // the value covering more than half of the bucket, if any; see rasterize()
+};
+
+
+// Where the boundaries of an interval_map lie in memory, see interval_map::layout().
+struct layout_stats
+{
+    std::size_t entries = 0;
+    // successors in key order whose node starts at most two node sizes after their predecessor's
+    std::size_t sequential = 0;
+    // mean distance in bytes between the nodes of successors in key order
+    double meanDistance = 0;
+
+    // Share of the steps of an in-order traversal that go to a nearby, likely prefetched node.
+    double sequentialFraction() const
+    {
+        return entries < 2 ? 1 : static_cast<double>(sequential) / static_cast<double>(entries - 1);
+    }
+};
+
+
+/*
+    Value predicate for interval_map that treats values at most epsilon apart as equal, for maps
+    of measurements where neighbouring ranges differ only by noise.
+
+    Only assign() outside a bulk scope snaps values with it. Inside a bulk scope, and in
+    assignPattern(), blit(), the constructor from sorted boundaries and the canonicalization that
+    ends a bulk scope, values are stored as given and merged only where operator== holds, so the
+    same assigns give an exact map there.
+*/
+template<typename V>
+struct absolute_tolerance
+{
+    V epsilon;
+
+    bool operator()(const V &lhs, const V &rhs) const
+    {
+        return lhs < rhs ? rhs - lhs <= epsilon : lhs - rhs <= epsilon;
+    }
+};
+
+
+template<typename K, typename V, typename ValueEqual = std::equal_to<V>, typename Allocator = std::allocator<std::pair<const K, V>>>
+class interval_map
+{
+private:
+    V m_valBegin;
+    std::map<K, V, std::less<K>, Allocator> m_map;
+    int m_bulkDepth = 0;
+    // false from beginBulk() until m_map is canonicalized again; a map moved out of a bulk
+    // scope carries it along and canonicalizes on its next change
+    bool m_canonical = true;
+    ValueEqual m_valueEqual;
+
+    static constexpr bool nothrowMove = std::is_nothrow_move_constructible_v<V> && std::is_nothrow_move_assignable_v<V>
+        && std::is_nothrow_move_constructible_v<std::map<K, V, std::less<K>, Allocator>>
+        && std::is_nothrow_move_assignable_v<std::map<K, V, std::less<K>, Allocator>>
+        && std::is_nothrow_move_constructible_v<ValueEqual> && std::is_nothrow_move_assignable_v<ValueEqual>;
+
+public:
+    interval_map(const V &value)
+        : m_valBegin(value)
+    { }
+
+    interval_map(const V &value, const Allocator &allocator)
+        : m_valBegin(value)
+        , m_map(allocator)
+    { }
+
+    // valueEqual replaces operator== when assign() merges a range with its neighbours, see assign().
+    interval_map(const V &value, const ValueEqual &valueEqual, const Allocator &allocator = Allocator())
+        : m_valBegin(value)
+        , m_map(allocator)
+        , m_valueEqual(valueEqual)
+    { }
+
+    // A bulk scope belongs to the map it was begun on: copies and moves do not inherit it, and the
+    // target of an assignment keeps its own scopes. A copy of a map inside a scope is canonicalized
+    // right away. Moves never compare values, so a map moved out of a scope may keep redundant
+    // boundaries until its next assign(), assignPattern() or blit() canonicalizes it.
+    interval_map(const interval_map &other)
+        : m_valBegin(other.m_valBegin)
+        , m_map(other.m_map)
+        , m_canonical(other.m_canonical)
+        , m_valueEqual(other.m_valueEqual)
+    {
+        restoreCanonical();
+    }
+
+    interval_map(interval_map &&other) noexcept(nothrowMove)
+        : m_valBegin(std::move(other.m_valBegin))
+        , m_map(std::move(other.m_map))
+        , m_canonical(other.m_canonical)
+        , m_valueEqual(std::move(other.m_valueEqual))
+    { }
+
+    interval_map &operator=(const interval_map &other)
+    {
+        if (this != &other)
+        {
+            m_valBegin = other.m_valBegin;
+            m_map = other.m_map;
+            m_canonical = other.m_canonical;
+            m_valueEqual = other.m_valueEqual;
+            restoreCanonical();
+        }
+        return *this;
+    }
+
+    interval_map &operator=(interval_map &&other) noexcept(nothrowMove)
+    {
+        if (this != &other)
+        {
+            m_valBegin = std::move(other.m_valBegin);
+            m_map = std::move(other.m_map);
+            m_canonical = other.m_canonical;
+            m_valueEqual = std::move(other.m_valueEqual);
+        }
+        return *this;
+    }
+
+    // Builds the map from (key, value) boundaries given in strictly increasing key order.
+    // Entries that repeat the value in effect before them are skipped.
+    template<typename InputIt>
+    interval_map(const V &value, InputIt first, InputIt last)
+        : m_valBegin(value)
+    {
+        const V *previous = &m_valBegin;
+        for (; first != last; ++first)
+        {
+            const auto &[key, val] = *first;
+            if (!(val == *previous))
+            {
+                previous = &m_map.emplace_hint(m_map.end(), key, val)->second;
+            }
+        }
+    }
+
+    /*
+        Each key-value-pair (k,v) in interval_map<K,V>::m_map means that the value v
+        is associated with all keys from k (including) to the next key (excluding) in m_map.
+        The member interval_map<K,V>::m_valBegin holds the value that is associated with all keys less than the first key in m_map.
+        Example: Let M be an instance of interval_map<int,char> where
+
+        M.m_valBegin=='A',
+        M.m_map=={ (1,'B'), (3,'A') },
+        Then M represents the mapping
+
+        ...
+        -2 -> 'A'
+        -1 -> 'A'
+        0 -> 'A'
+        1 -> 'B'
+        2 -> 'B'
+        3 -> 'A'
+        4 -> 'A'
+        5 -> 'A'
+        ...
+        The representation in the std::map must be canonical, that is, consecutive map entries must not contain the same value :
+        ..., (3, 'A'), (5, 'A'), ... is not allowed. Likewise, the first entry in m_map must not contain the same value as m_valBegin.
+        Initially, the whole range of K is associated with a given initial value, passed to the constructor of the interval_map<K, V> data structure.
+
+        Key type K
+            * besides being copyableand assignable, is less - than comparable via operator<, and
+            * does not implement any other operations, in particular no equality comparison or arithmetic operators.
+        Value type V
+            * besides being copyable and assignable, is equality - comparable via operator==, and
+            * does not implement any other operations.
+        Many solutions we receive are incorrect. Consider using a randomized test to discover the cases that your implementation does not handle correctly.
+        We recommend to implement a test function that tests the functionality of the interval_map, for example using a map of int intervals to char.
+
+        Your task is to implement the function assign. Your implementation is graded by the following criteria in this order:
+
+        Type requirements are met:
+            You must adhere to the specification of the key and value type given above.
+        Correctness:
+            Your program should produce a working interval_map with the behavior described above.
+            In particular, pay attention to the validity of iterators. It is illegal to dereference end iterators.
+            Consider using a checking STL implementation such as the one shipped with Visual C++ or GCC.
+        Canonicity:
+            The representation in m_map must be canonical.
+        Running time:
+            Imagine your implementation is part of a library, so it should be big-O optimal.
+
+        In addition:
+            * Do not make big-O more operations on K and V than necessary because you do not know how fast operations on K/V are;
+            remember that constructions, destructions and assignments are operations as well.
+            * Do not make more than one operation of amortized O(log N), in contrast to O(1), running time, where N is the number of elements in m_map.
+            Otherwise favor simplicity over minor speed improvements.
+            * You should not take longer than 9 hours, but you may of course be faster. Do not rush, we would not give you this assignment if it were trivial.
+    */
+
+    // Assign value val to interval [keyBegin, keyEnd).
+    // Overwrite previous values in this interval.
+    // Conforming to the C++ Standard Library conventions, the interval
+    // includes keyBegin, but excludes keyEnd.
+    // If !( keyBegin < keyEnd ), this designates an empty interval,
+    // and assign must do nothing.
+    //
+    // With a ValueEqual other than std::equal_to<V>, val is replaced by the value in effect before
+    // keyBegin if valueEqual(that value, val) holds, otherwise by the value in effect at keyEnd if
+    // that one is equal to val in the same sense, so that the range merges with its neighbour.
+    // Only the keys of [keyBegin, keyEnd) change, hence every key maps to a value that is equal
+    // to the last value assigned to it in the sense of ValueEqual; with absolute_tolerance the
+    // error is at most epsilon and does not accumulate over assigns. The map stays canonical
+    // with respect to operator==, but neighbouring entries may still be equal in the tolerant
+    // sense where merging them would change keys outside the assigned range.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        restoreCanonical();
+
+        // the only O(log N) step; everything below is hinted or proportional to the erased entries
+        auto first = m_map.lower_bound(keyBegin);
+        auto last = first;
+        while (last != m_map.end() && last->first < keyEnd)
+        {
+            ++last;
+        }
+        // [first, last) are the boundaries inside [keyBegin, keyEnd)
+
+        if constexpr (!std::is_same_v<ValueEqual, std::equal_to<V>>)
+        {
+            if (m_bulkDepth == 0)
+            {
+                const V &before = first == m_map.begin() ? m_valBegin : std::prev(first)->second;
+                const V &after = last != m_map.end() && !(keyEnd < last->first) ? last->second
+                    : first != last ? std::prev(last)->second
+                    : before;
+                const V *snapped = m_valueEqual(before, val) ? &before : m_valueEqual(after, val) ? &after : nullptr;
+                if (snapped)
+                {
+                    // copy, the neighbour's node may be erased on the way
+                    const V value = *snapped;
+                    assignRange(first, last, keyBegin, keyEnd, value);
+                    return;
+                }
+            }
+        }
+        assignRange(first, last, keyBegin, keyEnd, val);
+    }
+
+    // Assigns values[0] to [keyBegin, keyBegin + period), values[1] to the next period and so on,
+    // starting over with values[0] after the last value, up to keyEnd; the last period is cut off
+    // at keyEnd. The boundaries are built in one pass and replace [keyBegin, keyEnd) as a whole,
+    // in O(log N + boundaries in the range + keys / period). Does nothing for an empty range, a
+    // period that is not positive or no values.
+    template<typename It>
+    void assignPattern(const K &keyBegin, const K &keyEnd, const K &period, It first, It last)
+    {
+        static_assert(std::is_arithmetic_v<K>, "assignPattern needs arithmetic keys to step by period");
+        if (!(keyBegin < keyEnd) || !(K(0) < period) || first == last)
+        {
+            return;
+        }
+        replaceRange(keyBegin, keyEnd, [&](auto emit)
+        {
+            It value = first;
+            K key = keyBegin;
+            for (std::size_t index = 1; ; index++)
+            {
+                emit(key, *value);
+                if (++value == last)
+                {
+                    value = first;
+                }
+                if constexpr (std::is_integral_v<K>)
+                {
+                    // keyEnd - key > period, computed so that neither side can overflow
+                    using unsigned_type = std::make_unsigned_t<K>;
+                    if (static_cast<unsigned_type>(static_cast<unsigned_type>(keyEnd) - static_cast<unsigned_type>(key)) <= static_cast<unsigned_type>(period))
+                    {
+                        return;
+                    }
+                    key = static_cast<K>(key + period);
+                }
+                else
+                {
+                    // multiplied rather than summed up, so rounding errors do not accumulate
+                    key = static_cast<K>(keyBegin + period * static_cast<K>(index));
+                    if (!(key < keyEnd))
+                    {
+                        return;
+                    }
+                }
+            }
+        });
+    }
+
+    void assignPattern(const K &keyBegin, const K &keyEnd, const K &period, std::initializer_list<V> values)
+    {
+        assignPattern(keyBegin, keyEnd, period, values.begin(), values.end());
+    }
+
+    // Copies the values src has in [keyBegin, keyEnd) to [dstBegin, dstBegin + (keyEnd - keyBegin))
+    // of this map. The source segments replace the destination range as a whole, with both seams
+    // canonicalized, in O(log N + log M + k) for the k boundaries erased or copied. src may be this
+    // map, also with overlapping ranges.
+    void blit(const interval_map &src, const K &keyBegin, const K &keyEnd, const K &dstBegin)
+    {
+        static_assert(std::is_arithmetic_v<K>, "blit needs arithmetic keys to translate the range");
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        const K dstEnd = detail::translateKey(keyEnd, keyBegin, dstBegin);
+        if (&src == this)
+        {
+            // the source segments change while they are copied, take them out first
+            std::vector<std::pair<K, V>> segments;
+            forEachSegment(keyBegin, keyEnd, [&](const K &segmentBegin, const K &, const V &value)
+            {
+                segments.emplace_back(detail::translateKey(segmentBegin, keyBegin, dstBegin), value);
+            });
+            replaceRange(dstBegin, dstEnd, [&](auto emit)
+            {
+                for (const auto &[key, value]: segments)
+                {
+                    emit(key, value);
+                }
+            });
+            return;
+        }
+        replaceRange(dstBegin, dstEnd, [&](auto emit)
+        {
+            src.forEachSegment(keyBegin, keyEnd, [&](const K &segmentBegin, const K &, const V &value)
+            {
+                emit(detail::translateKey(segmentBegin, keyBegin, dstBegin), value);
+            });
+        });
+    }
+
+    // Scope of a bulk write phase, see beginBulk().
+    class bulk_scope
+    {
+    public:
+        bulk_scope(const bulk_scope &) = delete;
+        bulk_scope &operator=(const bulk_scope &) = delete;
+
+        // If comparing values throws while the map is canonicalized, the exception is swallowed:
+        // the map keeps every mapping but may hold redundant boundaries until the next assign(),
+        // assignPattern() or blit() canonicalizes it again.
+        ~bulk_scope()
+        {
+            try
+            {
+                m_map.endBulk();
+            }
+            catch (...)
+            { }
+        }
+
+    private:
+        friend class interval_map;
+
+        explicit bulk_scope(interval_map &map)
+            : m_map(map)
+        {
+            m_map.m_bulkDepth++;
+            m_map.m_canonical = false;
+        }
+
+        interval_map &m_map;
+    };
+
+    // Until the returned scope ends, assign() neither compares val with its neighbours nor merges
+    // them, so m_map may hold consecutive entries with equal values. Lookups stay correct.
+    // When the outermost scope ends the whole map is canonicalized in a single linear pass.
+    [[nodiscard]] bulk_scope beginBulk()
+    {
+        return bulk_scope(*this);
+    }
+
+    /*
+        Rebuilds m_map by inserting copies of its entries in key order, so that the nodes are
+        allocated one after the other; with node_arena_allocator they come from a new arena and
+        lie contiguously in key order, and the old arena is released. After a long run of assigns
+        the nodes of a tree are spread over the heap and every step of an in-order traversal is a
+        likely cache miss; compact() makes traversals and neighbouring lookups sequential again.
+
+        O(N) copies of K and V and N allocations; the map is unchanged if one of them throws.
+        It invalidates all iterators. layout() tells whether it is worth it.
+    */
+    void compact()
+    {
+        std::map<K, V, std::less<K>, Allocator> compacted(detail::freshAllocator(m_map.get_allocator(), m_map.size()));
+        for (const auto &entry: m_map)
+        {
+            compacted.emplace_hint(compacted.end(), entry);
+        }
+        m_map = std::move(compacted);
+    }
+
+    // Measures how scattered the nodes of m_map are, in one in-order traversal.
+    layout_stats layout() const
+    {
+        // a red-black tree node is the entry behind a color and three pointers
+        constexpr std::uintptr_t nodeSize = sizeof(typename decltype(m_map)::value_type) + 4 * sizeof(void *);
+        layout_stats stats;
+        stats.entries = m_map.size();
+        std::uintptr_t previous = 0;
+        double distance = 0;
+        for (const auto &entry: m_map)
+        {
+            const auto current = reinterpret_cast<std::uintptr_t>(std::addressof(entry));
+            if (previous != 0)
+            {
+                stats.sequential += previous < current && current - previous <= 2 * nodeSize;
+                distance += static_cast<double>(previous < current ? current - previous : previous - current);
+            }
+            previous = current;
+        }
+        if (stats.entries >= 2)
+        {
+            stats.meanDistance = distance / static_cast<double>(stats.entries - 1);
+        }
+        return stats;
+    }
+
+    const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    // Read-only access to the boundaries, i.e. the (key, value) pairs of m_map in key order.
+    auto begin() const
+    {
+        return m_map.begin();
+    }
+
+    auto end() const
+    {
+        return m_map.end();
+    }
+
+    // First boundary whose key is not less than key.
+    auto lowerBound(const K &key) const
+    {
+        return m_map.lower_bound(key);
+    }
+
+    std::size_t size() const
+    {
+        return m_map.size();
+    }
+
+    bool empty() const
+    {
+        return m_map.empty();
+    }
+
+    const V &operator[](const K &key) const
+    {
+        auto it = m_map.upper_bound(key);
+        if (it == m_map.begin()) {
+            return m_valBegin;
+        }
+        else {
+            return (--it)->second;
+        }
+    }
+
+    // Calls fn(segmentBegin, segmentEnd, value) for every maximal run [segmentBegin, segmentEnd) of
+    // keys with the same value that [keyBegin, keyEnd) is made of, in key order. The first and last
+    // run are cut off at keyBegin and keyEnd.
+    template<typename Fn>
+    void forEachSegment(const K &keyBegin, const K &keyEnd, Fn fn) const
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        auto next = m_map.upper_bound(keyBegin);
+        const V *value = next == m_map.begin() ? &m_valBegin : &std::prev(next)->second;
+        const K *segmentBegin = &keyBegin;
+        for (; next != m_map.end() && next->first < keyEnd; ++next)
+        {
+            fn(*segmentBegin, next->first, *value);
+            segmentBegin = &next->first;
+            value = &next->second;
+        }
+        fn(*segmentBegin, keyEnd, *value);
+    }
+
+    // Writes "[k, v]" for every entry of m_map, byte-for-byte like streaming them would.
+    template<typename OutputIt>
+    OutputIt writeMapSnippet(OutputIt out) const
+    {
+        for(const auto &[key, value]: m_map)
+        {
+            out = detail::writeBoundary(out, key, value);
+        }
+        return out;
+    }
+
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        if constexpr (detail::isFastFormattable<K> && detail::isFastFormattable<V>)
+        {
+            // every entry has a known upper bound, so format straight into the buffer
+            constexpr std::size_t maxEntrySize = detail::maxFormattedSize<K>() + detail::maxFormattedSize<V>() + 4;
+            result.resize(m_map.size() * maxEntrySize);
+            char *end = writeMapSnippet(result.data());
+            result.resize(end - result.data());
+        }
+        else
+        {
+            writeMapSnippet(std::back_inserter(result));
+        }
+        return result;
+    }
+
+    // Writes "k -> v\n" for every key in [keyBegin, keyEnd).
+    template<typename OutputIt>
+    OutputIt writeDataSlice(OutputIt out, const K &keyBegin, const K &keyEnd) const
+    {
+        forEachKey(keyBegin, keyEnd, [&out](const K &key, const V &value)
+        {
+            out = detail::formatValue(out, key);
+            out = detail::formatLiteral(out, " -> ");
+            out = detail::formatValue(out, value);
+            *out++ = '\n';
+        });
+        return out;
+    }
+
+    std::string getDataSlice(const K &keyBegin, const K &keyEnd) const
+    {
+        std::string result;
+        writeDataSlice(std::back_inserter(result), keyBegin, keyEnd);
+        return result;
+    }
+
+    // Writes the value of every key in [keyBegin, keyEnd).
+    template<typename OutputIt>
+    OutputIt writeValueSlice(OutputIt out, const K &keyBegin, const K &keyEnd) const
+    {
+        forEachKey(keyBegin, keyEnd, [&out](const K &, const V &value)
+        {
+            out = detail::formatValue(out, value);
+        });
+        return out;
+    }
+
+    std::string getValueSlice(const K &keyBegin, const K &keyEnd) const
+    {
+        std::string result;
+        writeValueSlice(std::back_inserter(result), keyBegin, keyEnd);
+        return result;
+    }
+
+    // Splits [keyBegin, keyEnd) into bucketCount buckets of (almost) equal size and writes one value
+    // per bucket, chosen by policy, in O(log N + boundaries in range + bucketCount) for arithmetic
+    // keys. A bucket without keys, which happens when the range has fewer keys than buckets, gets
+    // the value of the key it starts at.
+    //
+    // raster_policy::majority weighs the segments of a bucket by the keys they cover and picks a
+    // winner by a weighted Boyer-Moore vote: a value covering more than half of the bucket always
+    // wins, otherwise the result is one of the values in the bucket.
+    template<typename OutputIt>
+    OutputIt rasterize(const K &keyBegin, const K &keyEnd, std::size_t bucketCount, raster_policy policy, OutputIt out) const
+    {
+        static_assert(std::is_arithmetic_v<K>, "rasterize needs arithmetic keys to split the range");
+        if (!(keyBegin < keyEnd))
+        {
+            return out;
+        }
+
+        // value is in effect from the previous boundary up to next
+        auto next = m_map.upper_bound(keyBegin);
+        const V *value = next == m_map.begin() ? &m_valBegin : &std::prev(next)->second;
+        K bucketBegin = keyBegin;
+        for (std::size_t bucket = 1; bucket <= bucketCount; bucket++)
+        {
+            const K bucketEnd = detail::bucketStart(keyBegin, keyEnd, bucket, bucketCount);
+            while (next != m_map.end() && !(bucketBegin < next->first))
+            {
+                value = &next->second;
+                ++next;
+            }
+
+            if (policy == raster_policy::start)
+            {
+                *out++ = *value;
+            }
+            else if (policy == raster_policy::last)
+            {
+                while (next != m_map.end() && next->first < bucketEnd)
+                {
+                    value = &next->second;
+                    ++next;
+                }
+                *out++ = *value;
+            }
+            else
+            {
+                const V *winner = value;
+                double votes = 0;
+                K segmentBegin = bucketBegin;
+                auto vote = [&](const K &segmentEnd)
+                {
+                    const double weight = detail::keyDistance(segmentBegin, segmentEnd);
+                    if (*value == *winner)
+                    {
+                        votes += weight;
+                    }
+                    else if (votes < weight)
+                    {
+                        winner = value;
+                        votes = weight - votes;
+                    }
+                    else
+                    {
+                        votes -= weight;
+                    }
+                };
+                while (next != m_map.end() && next->first < bucketEnd)
+                {
+                    vote(next->first);
+                    segmentBegin = next->first;
+                    value = &next->second;
+                    ++next;
+                }
+                vote(bucketEnd);
+                *out++ = *winner;
+            }
+            bucketBegin = bucketEnd;
+        }
+        return out;
+    }
+
+private:
+    // Changes the key of the entry at it to key, which must sort between the keys of its
+    // neighbours, and returns the entry's new position. The node is reused unless the allocator
+    // is stateful; then the value is moved into a new node: libstdc++ does not destroy the
+    // allocator a node handle holds when the node is inserted again, which would leak the state
+    // of an allocator like node_arena_allocator.
+    auto rekey(typename decltype(m_map)::iterator it, const K &key)
+    {
+        if constexpr (std::allocator_traits<Allocator>::is_always_equal::value)
+        {
+            auto next = std::next(it);
+            auto node = m_map.extract(it);
+            node.key() = key;
+            return m_map.insert(next, std::move(node));
+        }
+        else
+        {
+            auto result = m_map.emplace_hint(key < it->first ? it : std::next(it), key, std::move_if_noexcept(it->second));
+            m_map.erase(it);
+            return result;
+        }
+    }
+
+    // assign() once [first, last) are known to be the boundaries inside [keyBegin, keyEnd).
+    void assignRange(typename decltype(m_map)::iterator first, typename decltype(m_map)::iterator last,
+        const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        // in bulk mode neighbours are not merged; endBulk() canonicalizes the whole map once
+        const bool canonical = m_bulkDepth == 0;
+
+        // keep the value that is in effect from keyEnd on
+        if (last == m_map.end() || keyEnd < last->first)
+        {
+            if (first != last)
+            {
+                // the last boundary inside the range holds that value, move its node to keyEnd
+                auto tail = std::prev(last);
+                if (!canonical || !(tail->second == val))
+                {
+                    const bool tailIsFirst = tail == first;
+                    last = rekey(tail, keyEnd);
+                    if (tailIsFirst)
+                    {
+                        first = last;
+                    }
+                }
+            }
+            else
+            {
+                const V &current = first == m_map.begin() ? m_valBegin : std::prev(first)->second;
+                if (!canonical || !(current == val))
+                {
+                    first = last = m_map.emplace_hint(last, keyEnd, current);
+                }
+            }
+        }
+        else if (canonical && last->second == val)
+        {
+            const bool lastIsFirst = last == first;
+            last = m_map.erase(last);
+            if (lastIsFirst)
+            {
+                first = last;
+            }
+        }
+
+        const V &before = first == m_map.begin() ? m_valBegin : std::prev(first)->second;
+        if (canonical && before == val)
+        {
+            m_map.erase(first, last);
+        }
+        else if (first == last)
+        {
+            m_map.emplace_hint(last, keyBegin, val);
+        }
+        else
+        {
+            // reuse the first node inside the range for keyBegin
+            m_map.erase(std::next(first), last);
+            first->second = val;
+            if (keyBegin < first->first)
+            {
+                rekey(first, keyBegin);
+            }
+        }
+    }
+
+    void endBulk()
+    {
+        if (--m_bulkDepth == 0)
+        {
+            canonicalize();
+        }
+    }
+
+    // Replaces the values of [keyBegin, keyEnd) with a run of boundaries: produce(emit) calls
+    // emit(key, value) with strictly increasing keys in [keyBegin, keyEnd), the first one being
+    // keyBegin. Entries repeating the value before them are skipped and both seams are
+    // canonicalized, so this costs O(log N + erased boundaries + emitted boundaries).
+    template<typename Produce>
+    void replaceRange(const K &keyBegin, const K &keyEnd, Produce produce)
+    {
+        restoreCanonical();
+        auto first = m_map.lower_bound(keyBegin);
+        auto last = first;
+        while (last != m_map.end() && last->first < keyEnd)
+        {
+            ++last;
+        }
+        // [first, last) are the boundaries inside [keyBegin, keyEnd)
+
+        // pin the value in effect from keyEnd on to a boundary at keyEnd, as assign() does
+        if (last == m_map.end() || keyEnd < last->first)
+        {
+            if (first != last)
+            {
+                auto tail = std::prev(last);
+                const bool tailIsFirst = tail == first;
+                last = rekey(tail, keyEnd);
+                if (tailIsFirst)
+                {
+                    first = last;
+                }
+            }
+            else
+            {
+                first = last = m_map.emplace_hint(last, keyEnd, first == m_map.begin() ? m_valBegin : std::prev(first)->second);
+            }
+        }
+        m_map.erase(first, last);
+
+        const V *previous = last == m_map.begin() ? &m_valBegin : &std::prev(last)->second;
+        produce([&](const K &key, const V &value)
+        {
+            if (!(value == *previous))
+            {
+                previous = &m_map.emplace_hint(last, key, value)->second;
+            }
+        });
+        if (last->second == *previous)
+        {
+            m_map.erase(last);
+        }
+    }
+
+    // Canonicalizes a map left non-canonical by a bulk scope that has ended.
+    void restoreCanonical()
+    {
+        if (!m_canonical && m_bulkDepth == 0)
+        {
+            canonicalize();
+        }
+    }
+
+    // Drops every entry whose value equals the value in effect before it.
+    void canonicalize()
+    {
+        const V *previous = &m_valBegin;
+        for(auto it = m_map.begin(); it != m_map.end();)
+        {
+            if (it->second == *previous)
+            {
+                it = m_map.erase(it);
+            }
+            else
+            {
+                previous = &it->second;
+                ++it;
+            }
+        }
+        m_canonical = true;
+    }
+
+    // Calls fn(key, (*this)[key]) for every key in [keyBegin, keyEnd), walking m_map
+    // alongside instead of searching it for each key.
+    template<typename Fn>
+    void forEachKey(const K &keyBegin, const K &keyEnd, Fn fn) const
+    {
+        auto next = m_map.upper_bound(keyBegin);
+        const V *value = next == m_map.begin() ? &m_valBegin : &std::prev(next)->second;
+        for(auto i = keyBegin; i < keyEnd; i++)
+        {
+            while (next != m_map.end() && !(i < next->first))
+            {
+                value = &next->second;
+                ++next;
+            }
+            fn(i, *value);
+        }
+    }
+};
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "interval_map.h"
+
+
+/*
+    Binary trace of the assign/operator[] traffic of one interval_map.
+
+    Layout (native byte order, no padding):
+        header:  "IMTRACE" '\0', uint8 version, uint8 key type, uint8 value type, V initial value
+        records: uint8 opcode followed by
+                     trace_opcode::assign  K keyBegin, K keyEnd, V value
+                     trace_opcode::lookup  K key
+
+    Keys and values are written bytewise, so only the arithmetic types listed in trace_type
+    can be recorded. interval_map<int, char> costs 10 bytes per assign and 5 per lookup.
+*/
+
+enum class trace_type : std::uint8_t
+{
+    int8 = 1, uint8, int16, uint16, int32, uint32, int64, uint64, float32, float64, character, boolean
+};
+
+enum class trace_opcode : std::uint8_t
+{
+    assign = 1,
+    lookup = 2
+};
+
+namespace detail
+{
+    constexpr char traceMagic[8] = {'I', 'M', 'T', 'R', 'A', 'C', 'E', '\0'};
+    constexpr std::uint8_t traceVersion = 1;
+
+    template<typename T>
+    constexpr trace_type traceTypeOf()
+    {
+        if constexpr (std::is_same_v<T, bool>) return trace_type::boolean;
+        else if constexpr (std::is_same_v<T, char>) return trace_type::character;
+        else if constexpr (std::is_floating_point_v<T>) return sizeof(T) == 4 ? trace_type::float32 : trace_type::float64;
+        else if constexpr (sizeof(T) == 1) return std::is_signed_v<T> ? trace_type::int8 : trace_type::uint8;
+        else if constexpr (sizeof(T) == 2) return std::is_signed_v<T> ? trace_type::int16 : trace_type::uint16;
+        else if constexpr (sizeof(T) == 4) return std::is_signed_v<T> ? trace_type::int32 : trace_type::uint32;
+        else return std::is_signed_v<T> ? trace_type::int64 : trace_type::uint64;
+    }
+
+    // Wide character types are left out: trace_type would record them as integers.
+    template<typename T>
+    constexpr bool isTraceable = std::is_arithmetic_v<T> && !std::is_same_v<T, long double> && sizeof(T) <= 8
+        && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>;
+}
+
+
+template<typename K, typename V>
+struct trace_op
+{
+    trace_opcode opcode;
+    K keyBegin;
+    K keyEnd; // unused for lookups
+    V value;  // unused for lookups
+};
+
+
+// Appends operations to a trace file; writes are buffered and flushed on destruction. A failed
+// write throws std::runtime_error from flush(), or from the destructor if no flush() reported it
+// before and no other exception is in flight; call flush() last to handle it in one place.
+template<typename K, typename V>
+class interval_map_trace_writer
+{
+    static_assert(detail::isTraceable<K> && detail::isTraceable<V>, "only arithmetic keys and values can be traced");
+
+public:
+    interval_map_trace_writer(const std::string &path, const V &initialValue)
+        : m_file(std::fopen(path.c_str(), "wb"))
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("cannot open trace file " + path);
+        }
+        put(detail::traceMagic);
+        put(detail::traceVersion);
+        put(detail::traceTypeOf<K>());
+        put(detail::traceTypeOf<V>());
+        put(initialValue);
+    }
+
+    interval_map_trace_writer(const interval_map_trace_writer &) = delete;
+    interval_map_trace_writer &operator=(const interval_map_trace_writer &) = delete;
+
+    ~interval_map_trace_writer() noexcept(false)
+    {
+        const bool unwinding = std::uncaught_exceptions() > 0;
+        try
+        {
+            if (!m_failed)
+            {
+                flush();
+            }
+        }
+        catch (...)
+        {
+            std::fclose(m_file);
+            if (unwinding)
+            {
+                return;
+            }
+            throw;
+        }
+        std::fclose(m_file);
+    }
+
+    void recordAssign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        put(trace_opcode::assign);
+        put(keyBegin);
+        put(keyEnd);
+        put(val);
+        if (m_buffer.size() >= bufferSize)
+        {
+            flush();
+        }
+    }
+
+    void recordLookup(const K &key)
+    {
+        put(trace_opcode::lookup);
+        put(key);
+        if (m_buffer.size() >= bufferSize)
+        {
+            flush();
+        }
+    }
+
+    // After a failed write the trace is incomplete: the records written so far stay in the file,
+    // the rest is lost.
+    void flush()
+    {
+        if (!m_buffer.empty())
+        {
+            const std::size_t written = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+            const bool complete = written == m_buffer.size();
+            m_buffer.clear();
+            if (!complete)
+            {
+                m_failed = true;
+                throw std::runtime_error("cannot write interval_map trace");
+            }
+        }
+        if (std::fflush(m_file) != 0)
+        {
+            m_failed = true;
+            throw std::runtime_error("cannot write interval_map trace");
+        }
+    }
+
+private:
+    static constexpr std::size_t bufferSize = 1 << 16;
+
+    template<typename T>
+    void put(const T &value)
+    {
+        const auto *bytes = reinterpret_cast<const char *>(&value);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    std::FILE *m_file;
+    std::vector<char> m_buffer;
+    // a flush() threw, the destructor does not report it again
+    bool m_failed = false;
+};
+
+
+// Reads a whole trace written by interval_map_trace_writer.
+class interval_map_trace_reader
+{
+public:
+    explicit interval_map_trace_reader(const std::string &path)
+    {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            throw std::runtime_error("cannot open trace file " + path);
+        }
+        char chunk[1 << 16];
+        std::size_t count;
+        while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            m_data.insert(m_data.end(), chunk, chunk + count);
+        }
+        std::fclose(file);
+
+        if (m_data.size() < headerSize || std::memcmp(m_data.data(), detail::traceMagic, sizeof(detail::traceMagic)) != 0)
+        {
+            throw std::runtime_error(path + " is not an interval_map trace");
+        }
+        if (static_cast<std::uint8_t>(m_data[8]) != detail::traceVersion)
+        {
+            throw std::runtime_error(path + " has an unsupported trace version");
+        }
+    }
+
+    trace_type keyType() const
+    {
+        return static_cast<trace_type>(m_data[9]);
+    }
+
+    trace_type valueType() const
+    {
+        return static_cast<trace_type>(m_data[10]);
+    }
+
+    // K and V must match keyType() and valueType().
+    template<typename K, typename V>
+    V initialValue() const
+    {
+        checkTypes<K, V>();
+        checkInitialValue<V>();
+        V value;
+        std::memcpy(&value, m_data.data() + headerSize, sizeof(V));
+        return value;
+    }
+
+    template<typename K, typename V>
+    std::vector<trace_op<K, V>> operations() const
+    {
+        checkTypes<K, V>();
+        checkInitialValue<V>();
+        std::vector<trace_op<K, V>> result;
+        std::size_t position = headerSize + sizeof(V);
+        auto get = [&](auto &value)
+        {
+            if (position + sizeof(value) > m_data.size())
+            {
+                throw std::runtime_error("truncated interval_map trace");
+            }
+            std::memcpy(&value, m_data.data() + position, sizeof(value));
+            position += sizeof(value);
+        };
+
+        while (position < m_data.size())
+        {
+            trace_op<K, V> op{};
+            get(op.opcode);
+            if (op.opcode == trace_opcode::assign)
+            {
+                get(op.keyBegin);
+                get(op.keyEnd);
+                get(op.value);
+            }
+            else if (op.opcode == trace_opcode::lookup)
+            {
+                get(op.keyBegin);
+            }
+            else
+            {
+                throw std::runtime_error("corrupt interval_map trace");
+            }
+            result.push_back(op);
+        }
+        return result;
+    }
+
+private:
+    static constexpr std::size_t headerSize = sizeof(detail::traceMagic) + 3;
+
+    // The header check in the constructor does not know sizeof(V).
+    template<typename V>
+    void checkInitialValue() const
+    {
+        if (m_data.size() < headerSize + sizeof(V))
+        {
+            throw std::runtime_error("truncated interval_map trace");
+        }
+    }
+
+    template<typename K, typename V>
+    void checkTypes() const
+    {
+        if (keyType() != detail::traceTypeOf<K>() || valueType() != detail::traceTypeOf<V>())
+        {
+            throw std::runtime_error("interval_map trace recorded with other key or value types");
+        }
+    }
+
+    std::vector<char> m_data;
+};
+
+
+// interval_map that optionally logs its traffic to a trace writer.
+template<typename K, typename V>
+class traced_interval_map
+{
+public:
+    explicit traced_interval_map(const V &value, interval_map_trace_writer<K, V> *recorder = nullptr)
+        : m_map(value)
+        , m_recorder(recorder)
+    { }
+
+    // Starts (or with nullptr stops) recording; the writer must outlive the recording.
+    void setRecorder(interval_map_trace_writer<K, V> *recorder)
+    {
+        m_recorder = recorder;
+    }
+
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (m_recorder)
+        {
+            m_recorder->recordAssign(keyBegin, keyEnd, val);
+        }
+        m_map.assign(keyBegin, keyEnd, val);
+    }
+
+    const V &operator[](const K &key) const
+    {
+        if (m_recorder)
+        {
+            m_recorder->recordLookup(key);
+        }
+        return m_map[key];
+    }
+
+    const interval_map<K, V> &map() const
+    {
+        return m_map;
+    }
+
+private:
+    interval_map<K, V> m_map;
+    interval_map_trace_writer<K, V> *m_recorder;
+};
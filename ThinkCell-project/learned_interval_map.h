@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "batch_search.h"
+#include "frozen_interval_map.h"
+
+
+namespace detail
+{
+    /*
+        Piecewise-linear model of the position of every key in a sorted array.
+
+        Built greedily in one pass with the shrinking-cone method: a segment keeps the range of
+        slopes through its first key that predict every key added so far within maxError, and a
+        new segment starts at the first key that would empty that range. upperBound() then only
+        searches the few positions around the prediction; the error actually reached by the stored
+        slopes is measured after building, so rounding cannot make the search window too small.
+    */
+    template<typename K>
+    class linear_model
+    {
+    public:
+        linear_model() = default;
+
+        linear_model(const K *keys, std::size_t count, std::size_t maxError)
+        {
+            const double epsilon = static_cast<double>(maxError);
+            std::size_t start = 0;
+            while (start < count)
+            {
+                double lowSlope = 0;
+                double highSlope = INFINITY;
+                std::size_t end = start + 1;
+                for (; end < count; end++)
+                {
+                    const double distance = keyDistance(keys[start], keys[end]);
+                    const double offset = static_cast<double>(end - start);
+                    const double low = std::max(lowSlope, (offset - epsilon) / distance);
+                    const double high = std::min(highSlope, (offset + epsilon) / distance);
+                    if (low > high)
+                    {
+                        break;
+                    }
+                    lowSlope = low;
+                    highSlope = high;
+                }
+                m_firstKeys.push_back(keys[start]);
+                m_segments.push_back({end == start + 1 ? 0.0 : (lowSlope + highSlope) / 2, start});
+                start = end;
+            }
+
+            for (std::size_t segment = 0; segment < m_segments.size(); segment++)
+            {
+                const std::size_t end = segment + 1 < m_segments.size() ? m_segments[segment + 1].base : count;
+                for (std::size_t i = m_segments[segment].base; i < end; i++)
+                {
+                    const std::size_t predicted = predict(segment, keys[i], count);
+                    m_maxError = std::max(m_maxError, predicted > i ? predicted - i : i - predicted);
+                }
+            }
+        }
+
+        std::size_t segmentCount() const
+        {
+            return m_segments.size();
+        }
+
+        // Largest distance between a predicted and the actual position of a key of the array.
+        std::size_t maxError() const
+        {
+            return m_maxError;
+        }
+
+        // Same as std::upper_bound(keys, keys + count, key) - keys for the array the model was built on.
+        std::size_t upperBound(const K *keys, std::size_t count, const K &key) const
+        {
+            if (count == 0 || key < keys[0])
+            {
+                return 0;
+            }
+            const std::size_t segment = static_cast<std::size_t>(
+                std::upper_bound(m_firstKeys.begin(), m_firstKeys.end(), key) - m_firstKeys.begin()) - 1;
+            const std::size_t predicted = predict(segment, key, count);
+
+            // the answer is one past the position of the last key <= key, so widen the window by one
+            const std::size_t low = predicted > m_maxError ? predicted - m_maxError : 0;
+            const std::size_t high = std::min(count, predicted + m_maxError + 2);
+            const std::size_t position = low + branchlessUpperBound(keys + low, high - low, key);
+            if ((position == low && low != 0 && key < keys[low - 1]) || (position == high && high != count && !(key < keys[high])))
+            {
+                // a query between two keys is predicted between their positions, barring rounding
+                return static_cast<std::size_t>(std::upper_bound(keys, keys + count, key) - keys);
+            }
+            return position;
+        }
+
+    private:
+        struct segment_type
+        {
+            double slope;
+            std::size_t base;
+        };
+
+        std::size_t predict(std::size_t segment, const K &key, std::size_t count) const
+        {
+            // keys of this segment all lie before the next segment's base, and so does their upper bound
+            const std::size_t last = segment + 1 < m_segments.size() ? m_segments[segment + 1].base : count - 1;
+            const double position = static_cast<double>(m_segments[segment].base)
+                                    + m_segments[segment].slope * keyDistance(m_firstKeys[segment], key);
+            return position < static_cast<double>(last) ? static_cast<std::size_t>(position) : last;
+        }
+
+        std::vector<K> m_firstKeys;
+        std::vector<segment_type> m_segments;
+        std::size_t m_maxError = 0;
+    };
+}
+
+
+/*
+    frozen_interval_map whose lookups go through a learned piecewise-linear model of the boundary
+    keys instead of a binary search over all of them. Pays off for large maps over numeric keys with
+    a smooth distribution, where few segments describe the keys and a lookup touches one or two
+    cache lines of m_keys; results are identical to frozen_interval_map::operator[].
+*/
+template<typename K, typename V>
+class learned_interval_map
+{
+    static_assert(std::is_arithmetic_v<K>, "learned_interval_map needs numeric keys");
+
+public:
+    template<typename Map>
+    explicit learned_interval_map(const Map &map, std::size_t maxError = 32)
+        : m_frozen{map}
+        , m_model{m_frozen.keys().data(), m_frozen.keys().size(), maxError}
+    {
+    }
+
+    const V &operator[](const K &key) const
+    {
+        const auto &keys = m_frozen.keys();
+        return m_frozen.values()[m_model.upperBound(keys.data(), keys.size(), key)];
+    }
+
+    const frozen_interval_map<K, V> &frozen() const
+    {
+        return m_frozen;
+    }
+
+    const detail::linear_model<K> &model() const
+    {
+        return m_model;
+    }
+
+    std::size_t size() const
+    {
+        return m_frozen.size();
+    }
+
+private:
+    frozen_interval_map<K, V> m_frozen;
+    detail::linear_model<K> m_model;
+};
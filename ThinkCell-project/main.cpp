@@ -1,182 +1,36 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <gtest/gtest.h>
-#include <map>
+#include <random>
 #include <sstream>
-
-
-template<typename K, typename V>
-class interval_map
-{
-private:
-    V m_valBegin;
-    std::map<K, V> m_map;
-
-public:
-    interval_map(const V &value)
-        : m_valBegin(value)
-    { }
-
-    /*
-        Each key-value-pair (k,v) in interval_map<K,V>::m_map means that the value v
-        is associated with all keys from k (including) to the next key (excluding) in m_map.
-        The member interval_map<K,V>::m_valBegin holds the value that is associated with all keys less than the first key in m_map.
-        Example: Let M be an instance of interval_map<int,char> where
-
-        M.m_valBegin=='A',
-        M.m_map=={ (1,'B'), (3,'A') },
-        Then M represents the mapping
-
-        ...
-        -2 -> 'A'
-        -1 -> 'A'
-        0 -> 'A'
-        1 -> 'B'
-        2 -> 'B'
-        3 -> 'A'
-        4 -> 'A'
-        5 -> 'A'
-        ...
-        The representation in the std::map must be canonical, that is, consecutive map entries must not contain the same value :
-        ..., (3, 'A'), (5, 'A'), ... is not allowed. Likewise, the first entry in m_map must not contain the same value as m_valBegin.
-        Initially, the whole range of K is associated with a given initial value, passed to the constructor of the interval_map<K, V> data structure.
-
-        Key type K
-            * besides being copyableand assignable, is less - than comparable via operator<, and
-            * does not implement any other operations, in particular no equality comparison or arithmetic operators.
-        Value type V
-            * besides being copyable and assignable, is equality - comparable via operator==, and
-            * does not implement any other operations.
-        Many solutions we receive are incorrect. Consider using a randomized test to discover the cases that your implementation does not handle correctly.
-        We recommend to implement a test function that tests the functionality of the interval_map, for example using a map of int intervals to char.
-
-        Your task is to implement the function assign. Your implementation is graded by the following criteria in this order:
-
-        Type requirements are met:
-            You must adhere to the specification of the key and value type given above.
-        Correctness:
-            Your program should produce a working interval_map with the behavior described above.
-            In particular, pay attention to the validity of iterators. It is illegal to dereference end iterators.
-            Consider using a checking STL implementation such as the one shipped with Visual C++ or GCC.
-        Canonicity:
-            The representation in m_map must be canonical.
-        Running time:
-            Imagine your implementation is part of a library, so it should be big-O optimal.
-
-        In addition:
-            * Do not make big-O more operations on K and V than necessary because you do not know how fast operations on K/V are;
-            remember that constructions, destructions and assignments are operations as well.
-            * Do not make more than one operation of amortized O(log N), in contrast to O(1), running time, where N is the number of elements in m_map.
-            Otherwise favor simplicity over minor speed improvements.
-            * You should not take longer than 9 hours, but you may of course be faster. Do not rush, we would not give you this assignment if it were trivial.
-    */
-
-    // Assign value val to interval [keyBegin, keyEnd).
-    // Overwrite previous values in this interval.
-    // Conforming to the C++ Standard Library conventions, the interval
-    // includes keyBegin, but excludes keyEnd.
-    // If !( keyBegin < keyEnd ), this designates an empty interval,
-    // and assign must do nothing.
-    void assign(const K &keyBegin, const K &keyEnd, const V &val)
-    {
-        if (!(keyBegin < keyEnd))
-        {
-            return;
-        }
-
-        auto eq = [](auto v1, auto v2)
-        {
-            return (!(v1 < v2) && !(v2 < v1));
-        };
-
-        auto lastValue = m_valBegin;
-        auto insertIterator = m_map.lower_bound(keyBegin);;
-        bool isShouldFulfill = true;
-
-        while (insertIterator != m_map.end())
-        {
-            if (insertIterator->first < keyEnd)
-            {
-                lastValue = insertIterator->second;
-                insertIterator = m_map.erase(insertIterator);
-            }
-            // if we hit the end of some range - no fullfil required
-            else
-            {
-                if (eq(insertIterator->first, keyEnd))
-                {
-                    isShouldFulfill = false;
-                }
-
-                break;
-            }
-        }
-
-        m_map.insert(insertIterator, {keyBegin, val});
-        if (isShouldFulfill)
-        {
-            m_map.insert(insertIterator, {keyEnd, lastValue});
-        }
-
-        // wipe out all duplicates
-        auto prevValue = m_valBegin;
-        for(auto it = m_map.begin(); it != m_map.end();)
-        {
-            if (it->second == prevValue)
-            {
-                it = m_map.erase(it);
-            }
-            else
-            {
-                prevValue = it->second;
-                it++;
-            }
-        }
-    }
-
-    const V &operator[](const K &key) const
-    {
-        auto it = m_map.upper_bound(key);
-        if (it == m_map.begin()) {
-            return m_valBegin;
-        }
-        else {
-            return (--it)->second;
-        }
-    }
-
-    std::string getMapSnippet() const
-    {
-        std::stringstream stream;
-        for(const auto &[key, value]: m_map)
-        {
-            stream << "[" << key << ", " << value << "]";
-        }
-        return stream.str();
-    }
-
-    std::string getDataSlice(const K &keyBegin, const K &keyEnd) const
-    {
-        std::stringstream stream;
-        for(auto i = keyBegin; i < keyEnd; i++)
-        {
-            stream << i << " -> " << (*this)[i] << "\n";
-        }
-
-        return stream.str();
-
-    }
-
-    std::string getValueSlice(const K &keyBegin, const K &keyEnd) const
-    {
-        std::stringstream stream;
-        for(auto i = keyBegin; i < keyEnd; i++)
-        {
-            stream << (*this)[i];
-        }
-
-        return stream.str();
-    }
-};
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <sys/wait.h>
+#include "interval_map.h"
+#include "adaptive_interval_map.h"
+#include "append_interval_map.h"
+#include "async_interval_map.h"
+#include "bitmap_interval_map.h"
+#include "constexpr_interval_map.h"
+#include "cow_interval_map.h"
+#include "fixed_interval_map.h"
+#include "frozen_interval_map.h"
+#include "interval_map_trace.h"
+#include "learned_interval_map.h"
+#include "node_arena.h"
+#include "parallel_for_each.h"
+#include "pyramid_interval_map.h"
+#include "radix_interval_map.h"
+#include "range_lock_manager.h"
+#include "shared_interval_map.h"
+#include "shared_value.h"
+#include "small_interval_map.h"
+#include "string_interval_map.h"
 
 
 TEST(testIntervalMap, testItemGetFromEmptyMap)
@@ -477,3 +331,2165 @@ TEST(testIntervalMap, InsertAtTheBeginDefaultsWithSomeSpace)
 
 
 
+
+TEST(testIntervalMap, snippetMatchesStreamFormatting)
+{
+    interval_map<int, double> imap{0.0};
+    imap.assign(-1000000, -5, 1.0 / 3);
+    imap.assign(-5, 7, -2.5e-7);
+    imap.assign(7, 100, 123456789.0);
+    imap.assign(100, 2147483647, std::numeric_limits<double>::infinity());
+
+    std::stringstream stream;
+    stream << "[" << -1000000 << ", " << 1.0 / 3 << "]"
+           << "[" << -5 << ", " << -2.5e-7 << "]"
+           << "[" << 7 << ", " << 123456789.0 << "]"
+           << "[" << 100 << ", " << std::numeric_limits<double>::infinity() << "]"
+           << "[" << 2147483647 << ", " << 0.0 << "]";
+    EXPECT_EQ(imap.getMapSnippet(), stream.str());
+}
+
+TEST(testIntervalMap, snippetOfManyEntriesMatchesStreamFormatting)
+{
+    interval_map<long long, unsigned char> imap{'a'};
+    std::stringstream stream;
+    for (long long i = 0; i < 1000; i++)
+    {
+        const long long key = i * 1000003LL - 500000000LL;
+        const unsigned char value = static_cast<unsigned char>('b' + i % 20);
+        imap.assign(key, key + 1, value);
+        stream << "[" << key << ", " << value << "]" << "[" << key + 1 << ", " << static_cast<unsigned char>('a') << "]";
+    }
+
+    EXPECT_EQ(imap.getMapSnippet(), stream.str());
+}
+
+TEST(testIntervalMap, snippetFallsBackToStreamForOtherTypes)
+{
+    interval_map<int, std::string> imap{"x"};
+    imap.assign(1, 3, "yy");
+
+    EXPECT_EQ(imap.getMapSnippet(), "[1, yy][3, x]");
+    EXPECT_EQ(imap.getValueSlice(0, 4), "xyyyyx");
+    EXPECT_EQ(imap.getDataSlice(0, 2), "0 -> x\n1 -> yy\n");
+}
+
+TEST(testIntervalMap, dataSliceMatchesOperatorIndex)
+{
+    interval_map<int, bool> imap{false};
+    imap.assign(-3, 2, true);
+    imap.assign(4, 6, true);
+
+    std::stringstream stream;
+    for (int i = -5; i < 8; i++)
+    {
+        stream << i << " -> " << imap[i] << "\n";
+    }
+    EXPECT_EQ(imap.getDataSlice(-5, 8), stream.str());
+}
+
+static std::string uniqueShmName(const char *suffix)
+{
+    return "/interval_map_test_" + std::to_string(::getpid()) + "_" + suffix;
+}
+
+TEST(testSharedIntervalMap, readerMatchesPublishedMap)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    imap.assign(5, 8, 'C');
+    imap.assign(-10, -3, 'D');
+
+    shared_interval_map_publisher<int, char> publisher{uniqueShmName("match")};
+    EXPECT_EQ(publisher.publish(imap), 1u);
+
+    shared_interval_map_reader<int, char> reader{uniqueShmName("match")};
+    EXPECT_EQ(reader.generation(), 1u);
+    EXPECT_EQ(reader.size(), imap.size());
+    for (int key = -15; key < 15; key++)
+    {
+        EXPECT_EQ(reader[key], imap[key]) << key;
+    }
+    shared_interval_map_publisher<int, char>::remove(uniqueShmName("match"));
+}
+
+TEST(testSharedIntervalMap, readerSwitchesVersionOnRefresh)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+
+    shared_interval_map_publisher<int, char> publisher{uniqueShmName("refresh")};
+    publisher.publish(imap);
+    shared_interval_map_reader<int, char> reader{uniqueShmName("refresh")};
+    EXPECT_FALSE(reader.refresh());
+
+    imap.assign(0, 10, 'C');
+    publisher.publish(imap);
+    imap.assign(3, 4, 'D');
+    publisher.publish(imap);
+
+    // the attached version stays valid although the publisher unlinked it
+    EXPECT_EQ(reader[3], 'B');
+    EXPECT_TRUE(reader.refresh());
+    EXPECT_EQ(reader.generation(), 3u);
+    EXPECT_EQ(reader[2], 'C');
+    EXPECT_EQ(reader[3], 'D');
+    EXPECT_EQ(reader[10], 'A');
+    shared_interval_map_publisher<int, char>::remove(uniqueShmName("refresh"));
+}
+
+TEST(testSharedIntervalMap, readerInOtherProcess)
+{
+    interval_map<long long, double> imap{0.5};
+    for (long long i = 0; i < 1000; i++)
+    {
+        imap.assign(i * 10, i * 10 + 5, static_cast<double>(i));
+    }
+
+    const std::string name = uniqueShmName("fork");
+    shared_interval_map_publisher<long long, double> publisher{name};
+    publisher.publish(imap);
+
+    const pid_t child = ::fork();
+    ASSERT_NE(child, -1);
+    if (child == 0)
+    {
+        shared_interval_map_reader<long long, double> reader{name};
+        bool ok = true;
+        for (long long key = -5; key < 10010; key++)
+        {
+            ok = ok && reader[key] == imap[key];
+        }
+        ::_exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    shared_interval_map_publisher<long long, double>::remove(name);
+}
+
+TEST(testSharedIntervalMap, refreshAfterPublisherIsGoneThrows)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    const std::string name = uniqueShmName("gone");
+    auto publisher = std::make_unique<shared_interval_map_publisher<int, char>>(name);
+    publisher->publish(imap);
+    shared_interval_map_reader<int, char> reader{name};
+
+    // the reader is one generation behind when the publisher unlinks everything
+    imap.assign(0, 10, 'C');
+    publisher->publish(imap);
+    publisher.reset();
+
+    EXPECT_THROW(reader.refresh(), std::runtime_error);
+    EXPECT_EQ(reader.generation(), 1u);
+    EXPECT_EQ(reader[3], 'B');
+    shared_interval_map_publisher<int, char>::remove(name);
+}
+
+TEST(testSharedIntervalMap, currentReaderSeesPublisherRestart)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    const std::string name = uniqueShmName("restart");
+    auto publisher = std::make_unique<shared_interval_map_publisher<int, char>>(name);
+    publisher->publish(imap);
+    shared_interval_map_reader<int, char> reader{name};
+    EXPECT_FALSE(reader.refresh());
+
+    // up to date, and still told that the publisher is gone
+    publisher.reset();
+    EXPECT_THROW(reader.refresh(), std::runtime_error);
+    EXPECT_EQ(reader[3], 'B');
+
+    // a new publisher continues the counter the reader is watching
+    publisher = std::make_unique<shared_interval_map_publisher<int, char>>(name);
+    EXPECT_FALSE(reader.refresh());
+    imap.assign(3, 4, 'C');
+    EXPECT_EQ(publisher->publish(imap), 2u);
+    EXPECT_TRUE(reader.refresh());
+    EXPECT_EQ(reader[3], 'C');
+
+    publisher.reset();
+    shared_interval_map_publisher<int, char>::remove(name);
+    EXPECT_THROW((shared_interval_map_reader<int, char>{name}), std::runtime_error);
+}
+
+TEST(testSharedIntervalMap, corruptLayoutThrows)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    const std::string name = uniqueShmName("corrupt");
+    {
+        shared_interval_map_publisher<int, char> publisher{name};
+        publisher.publish(imap);
+        auto data = detail::shm_mapping::open(name + ".1", true);
+        ASSERT_TRUE(data);
+        detail::shm_layout_header header;
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        auto attachWith = [&](const detail::shm_layout_header &patched)
+        {
+            std::memcpy(data.data(), &patched, sizeof(patched));
+            EXPECT_THROW((shared_interval_map_reader<int, char>{name}), std::runtime_error);
+        };
+        auto patched = header;
+        patched.count = 1u << 30;
+        attachWith(patched);
+        patched = header;
+        patched.valuesOffset = data.size();
+        attachWith(patched);
+        patched = header;
+        patched.keysOffset = 1;
+        attachWith(patched);
+
+        std::memcpy(data.data(), &header, sizeof(header));
+        shared_interval_map_reader<int, char> reader{name};
+        EXPECT_EQ(reader[3], 'B');
+    }
+    shared_interval_map_publisher<int, char>::remove(name);
+}
+
+TEST(testSharedIntervalMap, attachWithoutPublisherFails)
+{
+    EXPECT_THROW((shared_interval_map_reader<int, char>{uniqueShmName("missing")}), std::runtime_error);
+}
+
+TEST(testIntervalMapTrace, recordsAndReadsBackOperations)
+{
+    const std::string path = testing::TempDir() + "interval_map_trace_test.bin";
+    {
+        interval_map_trace_writer<int, char> writer{path, 'A'};
+        traced_interval_map<int, char> imap{'A', &writer};
+        imap.assign(2, 5, 'B');
+        EXPECT_EQ(imap[3], 'B');
+        imap.setRecorder(nullptr);
+        imap.assign(0, 1, 'C');
+        imap.setRecorder(&writer);
+        imap.assign(-7, 9, 'D');
+        EXPECT_EQ(imap.map().getMapSnippet(), "[-7, D][9, A]");
+    }
+
+    const interval_map_trace_reader trace{path};
+    EXPECT_EQ(trace.keyType(), trace_type::int32);
+    EXPECT_EQ(trace.valueType(), trace_type::character);
+    EXPECT_EQ((trace.initialValue<int, char>()), 'A');
+
+    const auto ops = trace.operations<int, char>();
+    ASSERT_EQ(ops.size(), 3u);
+    EXPECT_EQ(ops[0].opcode, trace_opcode::assign);
+    EXPECT_EQ(ops[0].keyBegin, 2);
+    EXPECT_EQ(ops[0].keyEnd, 5);
+    EXPECT_EQ(ops[0].value, 'B');
+    EXPECT_EQ(ops[1].opcode, trace_opcode::lookup);
+    EXPECT_EQ(ops[1].keyBegin, 3);
+    EXPECT_EQ(ops[2].keyBegin, -7);
+    EXPECT_EQ(ops[2].keyEnd, 9);
+    EXPECT_EQ(ops[2].value, 'D');
+
+    EXPECT_THROW((trace.operations<long long, char>()), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(testIntervalMapTrace, rejectsTruncatedInitialValue)
+{
+    const std::string path = testing::TempDir() + "interval_map_trace_truncated.bin";
+    {
+        interval_map_trace_writer<int, long long> writer{path, 42};
+    }
+    std::string bytes;
+    {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        char chunk[256];
+        std::size_t count;
+        while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            bytes.append(chunk, count);
+        }
+        std::fclose(file);
+    }
+    // keep the header and half of the initial value
+    bytes.resize(bytes.size() - sizeof(long long) / 2);
+    {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        std::fwrite(bytes.data(), 1, bytes.size(), file);
+        std::fclose(file);
+    }
+
+    const interval_map_trace_reader trace{path};
+    EXPECT_THROW((trace.initialValue<int, long long>()), std::runtime_error);
+    EXPECT_THROW((trace.operations<int, long long>()), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(testIntervalMapTrace, failedWritesThrow)
+{
+    static_assert(!detail::isTraceable<wchar_t> && !detail::isTraceable<char16_t> && !detail::isTraceable<char32_t>);
+
+    // /dev/full accepts the open and fails every write with ENOSPC
+    {
+        interval_map_trace_writer<int, char> writer{"/dev/full", 'A'};
+        writer.recordAssign(2, 5, 'B');
+        EXPECT_THROW(writer.flush(), std::runtime_error);
+        // reported once, the destructor stays quiet
+    }
+    // otherwise the destructor reports it
+    auto recordAndClose = []
+    {
+        interval_map_trace_writer<int, char> writer{"/dev/full", 'A'};
+        writer.recordLookup(3);
+    };
+    EXPECT_THROW(recordAndClose(), std::runtime_error);
+}
+
+TEST(testIntervalMapTrace, rejectsForeignFiles)
+{
+    const std::string path = testing::TempDir() + "interval_map_trace_foreign.bin";
+    {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        std::fputs("not a trace at all", file);
+        std::fclose(file);
+    }
+
+    EXPECT_THROW(interval_map_trace_reader{path}, std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// Brute force model of an interval_map<int, char> over a small key window.
+struct reference_interval_map
+{
+    static constexpr int lowest = -20;
+    static constexpr int highest = 60;
+
+    explicit reference_interval_map(char value)
+        : values(highest - lowest, value)
+    { }
+
+    void assign(int keyBegin, int keyEnd, char value)
+    {
+        for (int key = std::max(keyBegin, lowest); key < std::min(keyEnd, highest); key++)
+        {
+            values[key - lowest] = value;
+        }
+    }
+
+    std::string slice() const
+    {
+        return std::string(values.begin(), values.end());
+    }
+
+    std::vector<char> values;
+};
+
+template<typename Map>
+static void expectCanonical(const Map &imap)
+{
+    const char *previous = &imap.getValBegin();
+    for (const auto &entry: imap)
+    {
+        EXPECT_NE(entry.second, *previous) << "at key " << entry.first;
+        previous = &entry.second;
+    }
+}
+
+TEST(testIntervalMap, randomizedAssignMatchesReference)
+{
+    std::mt19937 random{12345};
+    std::uniform_int_distribution<int> key{reference_interval_map::lowest + 1, reference_interval_map::highest - 1};
+    std::uniform_int_distribution<int> value{'A', 'D'};
+
+    for (int round = 0; round < 200; round++)
+    {
+        interval_map<int, char> imap{'A'};
+        reference_interval_map reference{'A'};
+        for (int step = 0; step < 50; step++)
+        {
+            const int keyBegin = key(random);
+            const int keyEnd = key(random);
+            const char val = static_cast<char>(value(random));
+            imap.assign(keyBegin, keyEnd, val);
+            reference.assign(keyBegin, keyEnd, val);
+
+            ASSERT_EQ(imap.getValueSlice(reference_interval_map::lowest, reference_interval_map::highest), reference.slice());
+            expectCanonical(imap);
+        }
+    }
+}
+
+TEST(testIntervalMap, assignInsideSegmentKeepsItsValueAfterwards)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(0, 10, 'B');
+
+    imap.assign(3, 5, 'C');
+    EXPECT_EQ(imap.getMapSnippet(), "[0, B][3, C][5, B][10, A]");
+    imap.assign(12, 14, 'A');
+    EXPECT_EQ(imap.getMapSnippet(), "[0, B][3, C][5, B][10, A]");
+}
+
+TEST(testIntervalMap, rasterizeSimpleMap)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    imap.assign(9, 10, 'C');
+
+    std::string start;
+    imap.rasterize(0, 12, 4, raster_policy::start, std::back_inserter(start));
+    EXPECT_EQ(start, "ABAC");
+    std::string last;
+    imap.rasterize(0, 12, 4, raster_policy::last, std::back_inserter(last));
+    EXPECT_EQ(last, "BAAA");
+    std::string majority;
+    imap.rasterize(0, 12, 4, raster_policy::majority, std::back_inserter(majority));
+    EXPECT_EQ(majority, "ABAA");
+
+    // more buckets than keys: empty buckets repeat the key they start at
+    std::string fine;
+    imap.rasterize(1, 4, 6, raster_policy::majority, std::back_inserter(fine));
+    EXPECT_EQ(fine, "AABBBB");
+
+    interval_map<double, char> dmap{'A'};
+    dmap.assign(0.5, 0.75, 'B');
+    std::string values;
+    dmap.rasterize(0.0, 1.0, 4, raster_policy::start, std::back_inserter(values));
+    EXPECT_EQ(values, "AABA");
+}
+
+TEST(testIntervalMap, randomizedRasterizeMatchesPerKeyScan)
+{
+    std::mt19937 random{62};
+    interval_map<int, char> imap{'A'};
+    for (int step = 0; step < 200; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 1000) - 500;
+        imap.assign(keyBegin, keyBegin + static_cast<int>(random() % 60), static_cast<char>('A' + random() % 3));
+
+        const int rangeBegin = static_cast<int>(random() % 1200) - 600;
+        const int rangeEnd = rangeBegin + 1 + static_cast<int>(random() % 800);
+        const std::size_t buckets = 1 + random() % 100;
+        std::vector<char> start, last, majority;
+        imap.rasterize(rangeBegin, rangeEnd, buckets, raster_policy::start, std::back_inserter(start));
+        imap.rasterize(rangeBegin, rangeEnd, buckets, raster_policy::last, std::back_inserter(last));
+        imap.rasterize(rangeBegin, rangeEnd, buckets, raster_policy::majority, std::back_inserter(majority));
+        ASSERT_EQ(start.size(), buckets);
+        ASSERT_EQ(last.size(), buckets);
+        ASSERT_EQ(majority.size(), buckets);
+
+        for (std::size_t bucket = 0; bucket < buckets; bucket++)
+        {
+            const auto span = static_cast<long long>(rangeEnd - rangeBegin);
+            const int bucketBegin = rangeBegin + static_cast<int>(span * static_cast<long long>(bucket) / static_cast<long long>(buckets));
+            const int bucketEnd = rangeBegin + static_cast<int>(span * static_cast<long long>(bucket + 1) / static_cast<long long>(buckets));
+            ASSERT_EQ(start[bucket], imap[bucketBegin]);
+            ASSERT_EQ(last[bucket], imap[bucketEnd > bucketBegin ? bucketEnd - 1 : bucketBegin]);
+
+            int counts[3] = {};
+            for (int key = bucketBegin; key < bucketEnd; key++)
+            {
+                counts[imap[key] - 'A']++;
+            }
+            for (int value = 0; value < 3; value++)
+            {
+                if (2 * counts[value] > bucketEnd - bucketBegin)
+                {
+                    ASSERT_EQ(majority[bucket], 'A' + value) << bucketBegin << " " << bucketEnd;
+                }
+            }
+        }
+    }
+}
+
+TEST(testIntervalMap, forEachSegmentCutsAtRange)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(2, 5, 'B');
+    imap.assign(7, 9, 'C');
+    std::ostringstream segments;
+    imap.forEachSegment(3, 8, [&](int segmentBegin, int segmentEnd, char value)
+    {
+        segments << '[' << segmentBegin << ", " << segmentEnd << ") " << value << ' ';
+    });
+    EXPECT_EQ(segments.str(), "[3, 5) B [5, 7) A [7, 8) C ");
+
+    int calls = 0;
+    imap.forEachSegment(8, 8, [&](int, int, char) { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(testIntervalMap, assignPatternSimple)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(0, 100, 'Z');
+    imap.assignPattern(10, 25, 4, {'B', 'C'});
+    EXPECT_EQ(imap.getValueSlice(8, 27), "ZZBBBBCCCCBBBBCCCZZ");
+    EXPECT_EQ(imap.getMapSnippet(), "[0, Z][10, B][14, C][18, B][22, C][25, Z][100, A]");
+
+    // equal neighbours merge with the surroundings
+    imap.assignPattern(0, 12, 6, {'Z', 'Z'});
+    EXPECT_EQ(imap.getMapSnippet(), "[0, Z][12, B][14, C][18, B][22, C][25, Z][100, A]");
+    imap.assignPattern(-5, 100, 50, {'A'});
+    EXPECT_EQ(imap.getMapSnippet(), "");
+
+    imap.assignPattern(5, 5, 1, {'B'});
+    imap.assignPattern(5, 9, 0, {'B'});
+    EXPECT_EQ(imap.getMapSnippet(), "");
+
+    // periods running into the largest key
+    interval_map<std::uint16_t, char> shorts{'A'};
+    shorts.assignPattern(65530, 65535, 2, {'B', 'C'});
+    EXPECT_EQ(shorts.getMapSnippet(), "[65530, B][65532, C][65534, B][65535, A]");
+
+    interval_map<double, char> dmap{'A'};
+    dmap.assignPattern(0.0, 1.0, 0.25, {'B', 'C'});
+    EXPECT_EQ(dmap.getMapSnippet(), "[0, B][0.25, C][0.5, B][0.75, C][1, A]");
+}
+
+TEST(testIntervalMap, randomizedAssignPatternMatchesAssignLoop)
+{
+    std::mt19937 random{67};
+    interval_map<int, char> imap{'A'};
+    interval_map<int, char> reference{'A'};
+    for (int step = 0; step < 500; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 1000) - 500;
+        const int keyEnd = keyBegin + static_cast<int>(random() % 200);
+        const int period = 1 + static_cast<int>(random() % 12);
+        std::vector<char> values(1 + random() % 3);
+        for (char &value: values)
+        {
+            value = static_cast<char>('A' + random() % 3);
+        }
+
+        imap.assignPattern(keyBegin, keyEnd, period, values.begin(), values.end());
+        for (int key = keyBegin, index = 0; key < keyEnd; key += period, index++)
+        {
+            reference.assign(key, std::min(key + period, keyEnd), values[index % values.size()]);
+        }
+        ASSERT_EQ(imap.getMapSnippet(), reference.getMapSnippet());
+    }
+}
+
+TEST(testIntervalMap, blitCopiesRangeWithCanonicalSeams)
+{
+    interval_map<int, char> src{'A'};
+    src.assign(0, 4, 'B');
+    src.assign(4, 6, 'C');
+    interval_map<int, char> dst{'A'};
+    dst.assign(100, 200, 'B');
+
+    dst.blit(src, 2, 8, 110);
+    EXPECT_EQ(dst.getValueSlice(108, 118), "BBBBCCAABB");
+    EXPECT_EQ(dst.getMapSnippet(), "[100, B][112, C][114, A][116, B][200, A]");
+
+    // copying a range back onto itself changes nothing
+    dst.blit(dst, 90, 210, 90);
+    EXPECT_EQ(dst.getMapSnippet(), "[100, B][112, C][114, A][116, B][200, A]");
+
+    // overlapping self copy
+    dst.blit(dst, 110, 120, 115);
+    EXPECT_EQ(dst.getValueSlice(108, 130), "BBBBCCABBCCAABBBBBBBBB");
+}
+
+TEST(testIntervalMap, randomizedBlitMatchesPerKeyCopy)
+{
+    std::mt19937 random{68};
+    interval_map<int, char> src{'A'};
+    interval_map<int, char> dst{'A'};
+    for (int step = 0; step < 300; step++)
+    {
+        for (auto *map: {&src, &dst})
+        {
+            const int keyBegin = static_cast<int>(random() % 400);
+            map->assign(keyBegin, keyBegin + static_cast<int>(random() % 30), static_cast<char>('A' + random() % 3));
+        }
+
+        const int keyBegin = static_cast<int>(random() % 400) - 20;
+        const int keyEnd = keyBegin + static_cast<int>(random() % 100);
+        const int dstBegin = static_cast<int>(random() % 400) - 20;
+        const bool self = step % 4 == 0;
+        const interval_map<int, char> &source = self ? dst : src;
+
+        interval_map<int, char> reference{dst};
+        const std::string values = source.getValueSlice(keyBegin, keyEnd);
+        for (int key = keyBegin; key < keyEnd; key++)
+        {
+            reference.assign(dstBegin + key - keyBegin, dstBegin + key - keyBegin + 1, values[key - keyBegin]);
+        }
+        dst.blit(source, keyBegin, keyEnd, dstBegin);
+        ASSERT_EQ(dst.getMapSnippet(), reference.getMapSnippet()) << keyBegin << " " << keyEnd << " " << dstBegin;
+    }
+}
+
+TEST(testIntervalMapBulk, canonicalizesWhenScopeEnds)
+{
+    interval_map<int, char> imap{'A'};
+    {
+        auto bulk = imap.beginBulk();
+        imap.assign(2, 4, 'B');
+        imap.assign(4, 6, 'B');
+        imap.assign(6, 8, 'A');
+        imap.assign(0, 2, 'A');
+
+        // lookups see the right values while m_map is not canonical
+        EXPECT_EQ(imap.getValueSlice(0, 9), "AABBBBAAA");
+        EXPECT_NE(imap.getMapSnippet(), "[2, B][6, A]");
+    }
+    EXPECT_EQ(imap.getMapSnippet(), "[2, B][6, A]");
+}
+
+TEST(testIntervalMapBulk, nestedScopesCanonicalizeOnce)
+{
+    interval_map<int, char> imap{'A'};
+    {
+        auto outer = imap.beginBulk();
+        {
+            auto inner = imap.beginBulk();
+            imap.assign(0, 5, 'B');
+            imap.assign(5, 10, 'B');
+        }
+        EXPECT_EQ(imap.getMapSnippet(), "[0, B][5, B][10, A]");
+        imap.assign(10, 12, 'B');
+    }
+    EXPECT_EQ(imap.getMapSnippet(), "[0, B][12, A]");
+}
+
+TEST(testIntervalMapBulk, randomizedBulkMatchesReference)
+{
+    std::mt19937 random{777};
+    std::uniform_int_distribution<int> key{reference_interval_map::lowest + 1, reference_interval_map::highest - 1};
+    std::uniform_int_distribution<int> value{'A', 'C'};
+
+    for (int round = 0; round < 100; round++)
+    {
+        interval_map<int, char> imap{'A'};
+        interval_map<int, char> canonical{'A'};
+        reference_interval_map reference{'A'};
+        {
+            auto bulk = imap.beginBulk();
+            for (int step = 0; step < 40; step++)
+            {
+                const int keyBegin = key(random);
+                const int keyEnd = key(random);
+                const char val = static_cast<char>(value(random));
+                imap.assign(keyBegin, keyEnd, val);
+                canonical.assign(keyBegin, keyEnd, val);
+                reference.assign(keyBegin, keyEnd, val);
+                ASSERT_EQ(imap.getValueSlice(reference_interval_map::lowest, reference_interval_map::highest), reference.slice());
+            }
+        }
+        EXPECT_EQ(imap.getMapSnippet(), canonical.getMapSnippet());
+    }
+}
+
+TEST(testIntervalMap, copiesTakenInBulkModeAreCanonical)
+{
+    // moves never compare values, so they stay noexcept even if operator== is not
+    static_assert(std::is_nothrow_move_constructible_v<interval_map<int, char>>);
+    static_assert(std::is_nothrow_move_constructible_v<interval_map<int, std::string>>);
+    static_assert(!noexcept(std::declval<const shared_value<std::string> &>() == std::declval<const shared_value<std::string> &>()));
+    static_assert(std::is_nothrow_move_constructible_v<interval_map<int, shared_value<std::string>>>);
+    static_assert(std::is_nothrow_move_assignable_v<interval_map<int, shared_value<std::string>>>);
+
+    interval_map<int, char> imap{'A'};
+    interval_map<int, char> assigned{'A'};
+    interval_map<int, char> moveAssigned{'A'};
+    {
+        auto bulk = imap.beginBulk();
+        imap.assign(1, 3, 'B');
+        imap.assign(3, 5, 'B');
+        imap.assign(5, 7, 'A');
+
+        interval_map<int, char> copy = imap;
+        EXPECT_EQ(copy.getMapSnippet(), "[1, B][5, A]");
+        // the copy is not in bulk mode, so its assigns merge again
+        copy.assign(5, 9, 'B');
+        EXPECT_EQ(copy.getMapSnippet(), "[1, B][9, A]");
+
+        assigned = imap;
+        EXPECT_EQ(assigned.getMapSnippet(), "[1, B][5, A]");
+
+        interval_map<int, char> source = imap;
+        {
+            auto sourceBulk = source.beginBulk();
+            source.assign(7, 8, 'A');
+            interval_map<int, char> moved = std::move(source);
+            // the redundant boundaries at 7 and 8 stay until the next change
+            EXPECT_EQ(moved.getMapSnippet(), "[1, B][5, A][7, A][8, A]");
+            moveAssigned = std::move(moved);
+        }
+        EXPECT_EQ(moveAssigned.getMapSnippet(), "[1, B][5, A][7, A][8, A]");
+        moveAssigned.assign(8, 9, 'A');
+        EXPECT_EQ(moveAssigned.getMapSnippet(), "[1, B][5, A]");
+    }
+    EXPECT_EQ(imap.getMapSnippet(), "[1, B][5, A]");
+}
+
+namespace
+{
+    // Value whose comparison throws while throwOnCompare is set.
+    struct throwing_value
+    {
+        static inline bool throwOnCompare = false;
+
+        char id;
+
+        bool operator==(const throwing_value &other) const
+        {
+            if (throwOnCompare)
+            {
+                throw std::runtime_error("comparison failed");
+            }
+            return id == other.id;
+        }
+    };
+
+    std::ostream &operator<<(std::ostream &stream, const throwing_value &value)
+    {
+        return stream << value.id;
+    }
+}
+
+TEST(testIntervalMap, bulkScopeSurvivesThrowingCanonicalize)
+{
+    interval_map<int, throwing_value> imap{{'A'}};
+    {
+        auto bulk = imap.beginBulk();
+        imap.assign(1, 3, {'B'});
+        imap.assign(3, 5, {'B'});
+        throwing_value::throwOnCompare = true;
+    }
+    throwing_value::throwOnCompare = false;
+    // every mapping is intact, only the redundant boundary at 3 is left
+    EXPECT_EQ(imap.getMapSnippet(), "[1, B][3, B][5, A]");
+    EXPECT_EQ(imap[4].id, 'B');
+    // the next assign canonicalizes the whole map
+    imap.assign(7, 8, {'A'});
+    EXPECT_EQ(imap.getMapSnippet(), "[1, B][5, A]");
+}
+
+TEST(testIntervalMap, constructFromSortedBoundaries)
+{
+    const std::vector<std::pair<int, char>> boundaries{{1, 'B'}, {3, 'B'}, {5, 'A'}, {7, 'C'}, {9, 'A'}};
+    interval_map<int, char> imap{'A', boundaries.begin(), boundaries.end()};
+
+    EXPECT_EQ(imap.getMapSnippet(), "[1, B][5, A][7, C][9, A]");
+}
+
+TEST(testSmallIntervalMap, staysInlineWhileSmall)
+{
+    small_interval_map<int, char, 4> imap{'A'};
+    imap.assign(2, 5, 'B');
+    imap.assign(5, 8, 'C');
+
+    EXPECT_TRUE(imap.isInline());
+    EXPECT_EQ(imap.getMapSnippet(), "[2, B][5, C][8, A]");
+    EXPECT_EQ(imap[1], 'A');
+    EXPECT_EQ(imap[2], 'B');
+    EXPECT_EQ(imap[7], 'C');
+    EXPECT_EQ(imap[8], 'A');
+
+    imap.assign(0, 10, 'A');
+    EXPECT_TRUE(imap.isInline());
+    EXPECT_EQ(imap.size(), 0u);
+}
+
+TEST(testSmallIntervalMap, promotesWhenFull)
+{
+    small_interval_map<int, char, 4> imap{'A'};
+    imap.assign(0, 2, 'B');
+    imap.assign(4, 6, 'C');
+    EXPECT_TRUE(imap.isInline());
+
+    imap.assign(8, 10, 'D');
+    EXPECT_FALSE(imap.isInline());
+    EXPECT_EQ(imap.getMapSnippet(), "[0, B][2, A][4, C][6, A][8, D][10, A]");
+
+    small_interval_map<int, char, 4> copy{imap};
+    imap.assign(0, 10, 'E');
+    EXPECT_EQ(imap.getMapSnippet(), "[0, E][10, A]");
+    EXPECT_EQ(copy.getMapSnippet(), "[0, B][2, A][4, C][6, A][8, D][10, A]");
+}
+
+TEST(testSmallIntervalMap, randomizedMatchesIntervalMap)
+{
+    std::mt19937 random{4242};
+    std::uniform_int_distribution<int> key{reference_interval_map::lowest + 1, reference_interval_map::highest - 1};
+    std::uniform_int_distribution<int> value{'A', 'C'};
+
+    for (int round = 0; round < 300; round++)
+    {
+        small_interval_map<int, char, 6> small{'A'};
+        interval_map<int, char> imap{'A'};
+        for (int step = 0; step < 12; step++)
+        {
+            const int keyBegin = key(random);
+            const int keyEnd = keyBegin + key(random) % 15;
+            const char val = static_cast<char>(value(random));
+            small.assign(keyBegin, keyEnd, val);
+            imap.assign(keyBegin, keyEnd, val);
+
+            ASSERT_EQ(small.getMapSnippet(), imap.getMapSnippet());
+            for (int probe = reference_interval_map::lowest; probe < reference_interval_map::highest; probe++)
+            {
+                ASSERT_EQ(small[probe], imap[probe]);
+            }
+        }
+    }
+}
+
+TEST(testSmallIntervalMap, worksWithNonDefaultConstructibleValues)
+{
+    small_interval_map<int, std::string, 3> imap{std::string("x")};
+    imap.assign(1, 3, "yy");
+    imap.assign(2, 5, "zzz");
+
+    EXPECT_EQ(imap.getMapSnippet(), "[1, yy][2, zzz][5, x]");
+    imap.assign(7, 8, "w");
+    EXPECT_FALSE(imap.isInline());
+    EXPECT_EQ(imap.getMapSnippet(), "[1, yy][2, zzz][5, x][7, w][8, x]");
+}
+
+TEST(testAppendIntervalMap, tailAssignsExtendAndOverwrite)
+{
+    append_interval_map<long long, int> series{0};
+    series.assign(10, 20, 1);
+    series.assign(20, 30, 2);
+    series.assign(30, 40, 2);
+    EXPECT_EQ(series.getMapSnippet(), "[10, 1][20, 2][40, 0]");
+
+    // overwrite the tail, popping boundaries
+    series.assign(15, 50, 3);
+    EXPECT_EQ(series.getMapSnippet(), "[10, 1][15, 3][50, 0]");
+    series.assign(50, 60, 3);
+    EXPECT_EQ(series.getMapSnippet(), "[10, 1][15, 3][60, 0]");
+    series.assign(5, 100, 0);
+    EXPECT_EQ(series.size(), 0u);
+}
+
+TEST(testAppendIntervalMap, nonTailAssignsMatchIntervalMap)
+{
+    std::mt19937 random{99};
+    std::uniform_int_distribution<int> key{reference_interval_map::lowest + 1, reference_interval_map::highest - 1};
+    std::uniform_int_distribution<int> value{'A', 'C'};
+
+    for (int round = 0; round < 200; round++)
+    {
+        append_interval_map<int, char> series{'A'};
+        interval_map<int, char> imap{'A'};
+        for (int step = 0; step < 30; step++)
+        {
+            const int keyBegin = key(random);
+            const int keyEnd = key(random);
+            const char val = static_cast<char>(value(random));
+            series.assign(keyBegin, keyEnd, val);
+            imap.assign(keyBegin, keyEnd, val);
+            ASSERT_EQ(series.getMapSnippet(), imap.getMapSnippet());
+        }
+    }
+}
+
+TEST(testAppendIntervalMap, lookupsOnSkewedKeys)
+{
+    append_interval_map<std::uint64_t, int> series{-1};
+    interval_map<std::uint64_t, int> imap{-1};
+    std::uint64_t timestamp = 1000;
+    for (int i = 0; i < 5000; i++)
+    {
+        // mostly dense keys with a few huge gaps, which defeat pure interpolation
+        timestamp += i % 1000 == 0 ? 1000000000ULL : static_cast<std::uint64_t>(1 + i % 7);
+        series.assign(timestamp, timestamp + 3, i);
+        imap.assign(timestamp, timestamp + 3, i);
+    }
+    ASSERT_EQ(series.size(), imap.size());
+
+    std::mt19937_64 random{5};
+    for (const auto &[key, value]: imap)
+    {
+        ASSERT_EQ(series[key], value);
+        ASSERT_EQ(series[key - 1], imap[key - 1]);
+    }
+    for (int i = 0; i < 10000; i++)
+    {
+        const std::uint64_t probe = random() % (timestamp + 10);
+        ASSERT_EQ(series[probe], imap[probe]) << probe;
+    }
+}
+
+TEST(testAppendIntervalMap, floatingPointKeys)
+{
+    append_interval_map<double, char> series{'A'};
+    for (int i = 0; i < 100; i++)
+    {
+        series.assign(i * 0.5, i * 0.5 + 0.25, static_cast<char>('B' + i % 3));
+    }
+
+    EXPECT_EQ(series[-1.0], 'A');
+    EXPECT_EQ(series[0.1], 'B');
+    EXPECT_EQ(series[0.3], 'A');
+    EXPECT_EQ(series[0.5], 'C');
+    EXPECT_EQ(series[49.8], 'A');
+    EXPECT_EQ(series[49.5], static_cast<char>('B' + 99 % 3));
+}
+
+// Keys clustered around a few chunk borders of bitmap_interval_map, plus the very ends.
+static std::uint32_t randomBitmapKey(std::mt19937 &random)
+{
+    static const std::uint32_t anchors[] = {0, 65536, 3 * 65536, 7 * 65536 + 100, 4294967295u - 70000};
+    const std::uint32_t anchor = anchors[random() % 5];
+    const std::uint32_t offset = random() % 9000;
+    return random() % 2 ? anchor + offset : (anchor > offset ? anchor - offset : 0);
+}
+
+TEST(testBitmapIntervalMap, simpleAssignments)
+{
+    bitmap_interval_map bitmap{false};
+    bitmap.assign(10, 20, true);
+    bitmap.assign(15, 70000, true);
+    EXPECT_EQ(bitmap.getMapSnippet(), "[10, 1][70000, 0]");
+    EXPECT_FALSE(bitmap[9]);
+    EXPECT_TRUE(bitmap[65535]);
+    EXPECT_TRUE(bitmap[65536]);
+    EXPECT_FALSE(bitmap[70000]);
+
+    bitmap.assign(0, 4294967295u, false);
+    EXPECT_EQ(bitmap.getMapSnippet(), "");
+    EXPECT_EQ(bitmap.chunkCount(), 0u);
+}
+
+TEST(testBitmapIntervalMap, wideRangesUseOneRunPerChunk)
+{
+    bitmap_interval_map bitmap{false};
+    bitmap.assign(100, 100 + 50 * 65536, true);
+    EXPECT_EQ(bitmap.getMapSnippet(), "[100, 1][3276900, 0]");
+    EXPECT_EQ(bitmap.chunkCount(), 51u);
+
+    bitmap.assign(5, 3276900, false);
+    EXPECT_EQ(bitmap.chunkCount(), 0u);
+}
+
+TEST(testBitmapIntervalMap, randomizedMatchesIntervalMap)
+{
+    std::mt19937 random{2024};
+    for (int round = 0; round < 12; round++)
+    {
+        const bool initial = round % 2;
+        bitmap_interval_map bitmap{initial};
+        interval_map<std::uint32_t, bool> imap{initial};
+        for (int step = 0; step < 60; step++)
+        {
+            const std::uint32_t keyBegin = randomBitmapKey(random);
+            const std::uint32_t keyEnd = random() % 16 ? keyBegin + random() % 3000 : randomBitmapKey(random);
+            // dense single keys push chunks into array and bitset form
+            const bool val = random() % 3 != 0;
+            bitmap.assign(keyBegin, keyEnd, val);
+            imap.assign(keyBegin, keyEnd, val);
+            for (int single = 0; single < 40; single++)
+            {
+                const std::uint32_t key = keyBegin + random() % 6000;
+                bitmap.assign(key, key + 1, !val);
+                imap.assign(key, key + 1, !val);
+            }
+            if (step % 10 == 9)
+            {
+                ASSERT_EQ(bitmap.getMapSnippet(), imap.getMapSnippet());
+            }
+        }
+        for (const auto &[key, value]: imap)
+        {
+            ASSERT_EQ(bitmap[key], value);
+            ASSERT_EQ(bitmap[key - 1], imap[key - 1]);
+        }
+    }
+}
+
+TEST(testBitmapIntervalMap, containersChangeAcrossThresholds)
+{
+    bitmap_interval_map bitmap{false};
+    interval_map<std::uint32_t, bool> reference{false};
+    auto assign = [&](std::uint32_t keyBegin, std::uint32_t keyEnd, bool val)
+    {
+        bitmap.assign(keyBegin, keyEnd, val);
+        reference.assign(keyBegin, keyEnd, val);
+    };
+    // every third key: runs until 2047 of them, then an array, then a bitset
+    for (std::uint32_t key = 0; key < 3 * 6000; key += 3)
+    {
+        assign(key, key + 1, true);
+    }
+    ASSERT_EQ(bitmap.getMapSnippet(), reference.getMapSnippet());
+    // clearing back to 4096 keys turns the bitset into an array, which the range at 30000 overflows
+    assign(0, 3 * 2000, false);
+    ASSERT_EQ(bitmap.getMapSnippet(), reference.getMapSnippet());
+    assign(3 * 2000 + 1, 3 * 2000 + 200, true);
+    ASSERT_EQ(bitmap.getMapSnippet(), reference.getMapSnippet());
+    assign(30000, 30000 + 5000, true);
+    ASSERT_EQ(bitmap.getMapSnippet(), reference.getMapSnippet());
+    // a full chunk is stored as one run, an empty one not at all
+    assign(0, 1u << 16, true);
+    assign(100, 101, false);
+    assign(100, 101, true);
+    EXPECT_EQ(bitmap.getMapSnippet(), reference.getMapSnippet());
+    EXPECT_EQ(bitmap.chunkCount(), 1u);
+    assign(0, 1u << 16, false);
+    EXPECT_EQ(bitmap.chunkCount(), 0u);
+}
+
+TEST(testBitmapIntervalMap, setOperationsMatchPointwiseResults)
+{
+    std::mt19937 random{31337};
+    for (int round = 0; round < 20; round++)
+    {
+        bitmap_interval_map a{round % 2 == 0};
+        bitmap_interval_map b{round % 3 == 0};
+        interval_map<std::uint32_t, bool> ma{round % 2 == 0};
+        interval_map<std::uint32_t, bool> mb{round % 3 == 0};
+        for (int step = 0; step < 300; step++)
+        {
+            const std::uint32_t keyBegin = randomBitmapKey(random);
+            const std::uint32_t keyEnd = keyBegin + (step % 10 == 0 ? random() % 200000 : random() % 50);
+            const bool val = random() % 2;
+            if (step % 2)
+            {
+                a.assign(keyBegin, keyEnd, val);
+                ma.assign(keyBegin, keyEnd, val);
+            }
+            else
+            {
+                b.assign(keyBegin, keyEnd, val);
+                mb.assign(keyBegin, keyEnd, val);
+            }
+        }
+
+        const bitmap_interval_map conjunction = a & b;
+        const bitmap_interval_map disjunction = a | b;
+        bitmap_interval_map exclusive = a;
+        exclusive ^= b;
+
+        std::vector<std::uint32_t> probes{0, 4294967295u};
+        for (const auto *imap: {&ma, &mb})
+        {
+            for (const auto &entry: *imap)
+            {
+                probes.push_back(entry.first);
+                probes.push_back(entry.first - 1);
+            }
+        }
+        for (std::uint32_t key: probes)
+        {
+            ASSERT_EQ(conjunction[key], ma[key] && mb[key]) << key;
+            ASSERT_EQ(disjunction[key], ma[key] || mb[key]) << key;
+            ASSERT_EQ(exclusive[key], ma[key] != mb[key]) << key;
+        }
+
+        // results are canonical: every reported boundary really changes the value
+        bool previous = exclusive[0];
+        exclusive.forEachBoundary([&](std::uint32_t key, bool value)
+        {
+            if (key != 0)
+            {
+                EXPECT_NE(value, exclusive[key - 1]) << key;
+            }
+            EXPECT_EQ(exclusive[key], value);
+            previous = value;
+        });
+    }
+}
+
+TEST(testRadixIntervalMap, splitsAndCollapsesNodes)
+{
+    radix_interval_map<std::uint32_t, char> radix{'A'};
+    radix.assign(2, 5, 'B');
+    radix.assign(5, 8, 'C');
+    EXPECT_EQ(radix.getMapSnippet(), "[2, B][5, C][8, A]");
+    EXPECT_EQ(radix.nodeCount(), 4u);
+    EXPECT_EQ(radix[1], 'A');
+    EXPECT_EQ(radix[4], 'B');
+    EXPECT_EQ(radix[7], 'C');
+    EXPECT_EQ(radix[4000000000u], 'A');
+
+    radix.assign(0, 256, 'A');
+    EXPECT_EQ(radix.getMapSnippet(), "");
+    EXPECT_EQ(radix.nodeCount(), 0u);
+}
+
+TEST(testRadixIntervalMap, alignedRangesTakeOneSlot)
+{
+    radix_interval_map<std::uint64_t, int> permissions{0};
+    permissions.assign(0x7f0000000000ULL, 0x7f0100000000ULL, 5);
+    // one node per level above the slot that covers the 2^32 keys
+    EXPECT_EQ(permissions.nodeCount(), 4u);
+    EXPECT_EQ(permissions[0x7f0000000000ULL - 1], 0);
+    EXPECT_EQ(permissions[0x7f0000000000ULL], 5);
+    EXPECT_EQ(permissions[0x7f00ffffffffULL], 5);
+    EXPECT_EQ(permissions[0x7f0100000000ULL], 0);
+    EXPECT_EQ(permissions.getMapSnippet(), "[139637976727552, 5][139642271694848, 0]");
+
+    permissions.assign(0, 0xffffffffffffffffULL, 7);
+    EXPECT_EQ(permissions.getMapSnippet(), "[0, 7][18446744073709551615, 0]");
+}
+
+TEST(testRadixIntervalMap, randomizedMatchesIntervalMap)
+{
+    std::mt19937 random{808};
+    for (int round = 0; round < 100; round++)
+    {
+        radix_interval_map<std::uint16_t, char, 4> radix{'A'};
+        interval_map<std::uint16_t, char> imap{'A'};
+        for (int step = 0; step < 40; step++)
+        {
+            const auto keyBegin = static_cast<std::uint16_t>(random() % 65536);
+            const auto keyEnd = static_cast<std::uint16_t>(step % 3 ? keyBegin + random() % 300 : random() % 65536);
+            const char val = static_cast<char>('A' + random() % 3);
+            radix.assign(keyBegin, keyEnd, val);
+            imap.assign(keyBegin, keyEnd, val);
+            ASSERT_EQ(radix.getMapSnippet(), imap.getMapSnippet());
+        }
+
+        radix_interval_map<std::uint16_t, char, 4> copy{radix};
+        for (std::uint32_t key = 0; key < 65536; key += 7)
+        {
+            ASSERT_EQ(copy[static_cast<std::uint16_t>(key)], imap[static_cast<std::uint16_t>(key)]);
+        }
+    }
+}
+
+TEST(testRadixIntervalMap, copiesShareNodesUntilAssigned)
+{
+    std::mt19937 random{63};
+    radix_interval_map<std::uint16_t, char, 4> radix{'A'};
+    interval_map<std::uint16_t, char> imap{'A'};
+    for (int step = 0; step < 200; step++)
+    {
+        const auto keyBegin = static_cast<std::uint16_t>(random() % 65536);
+        const auto keyEnd = static_cast<std::uint16_t>(keyBegin + random() % 300);
+        const char val = static_cast<char>('A' + random() % 3);
+        radix.assign(keyBegin, keyEnd, val);
+        imap.assign(keyBegin, keyEnd, val);
+    }
+
+    // both sides keep changing after the copy, each must only see its own assigns
+    radix_interval_map<std::uint16_t, char, 4> copy{radix};
+    interval_map<std::uint16_t, char> copyReference{imap};
+    for (int step = 0; step < 200; step++)
+    {
+        const auto keyBegin = static_cast<std::uint16_t>(random() % 65536);
+        const auto keyEnd = static_cast<std::uint16_t>(keyBegin + random() % 300);
+        const char val = static_cast<char>('A' + random() % 4);
+        if (step % 2)
+        {
+            radix.assign(keyBegin, keyEnd, val);
+            imap.assign(keyBegin, keyEnd, val);
+        }
+        else
+        {
+            copy.assign(keyBegin, keyEnd, val);
+            copyReference.assign(keyBegin, keyEnd, val);
+        }
+        ASSERT_EQ(radix.getMapSnippet(), imap.getMapSnippet());
+        ASSERT_EQ(copy.getMapSnippet(), copyReference.getMapSnippet());
+    }
+}
+
+TEST(testCowIntervalMap, copiesShareUntilAssigned)
+{
+    cow_interval_map<int, char> original{'A'};
+    original.assign(1, 5, 'B');
+    EXPECT_FALSE(original.shared());
+
+    cow_interval_map<int, char> snapshot{original};
+    EXPECT_TRUE(original.shared());
+    EXPECT_EQ(&snapshot.get(), &original.get());
+
+    original.assign(3, 8, 'C');
+    EXPECT_FALSE(original.shared());
+    EXPECT_FALSE(snapshot.shared());
+    EXPECT_EQ(original.getMapSnippet(), "[1, B][3, C][8, A]");
+    EXPECT_EQ(snapshot.getMapSnippet(), "[1, B][5, A]");
+    EXPECT_EQ(snapshot[4], 'B');
+
+    // an empty assign does not unshare
+    cow_interval_map<int, char> another{original};
+    original.assign(5, 5, 'D');
+    EXPECT_TRUE(original.shared());
+}
+
+TEST(testCowIntervalMap, snapshotsReadWhileWriterContinues)
+{
+    cow_interval_map<int, int> map{0};
+    std::vector<std::thread> readers;
+    for (int version = 1; version <= 8; version++)
+    {
+        map.assign(0, 1000, version);
+        readers.emplace_back([snapshot = map, version]
+        {
+            for (int round = 0; round < 100; round++)
+            {
+                for (int key = 0; key < 1000; key += 13)
+                {
+                    ASSERT_EQ(snapshot[key], version);
+                }
+            }
+        });
+    }
+    for (auto &reader: readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(map[500], 8);
+}
+
+TEST(testFrozenIntervalMap, matchesSourceMap)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(1, 3, 'B');
+    imap.assign(5, 10, 'C');
+    imap.assign(7, 8, 'D');
+    const frozen_interval_map<int, char> frozen{imap};
+    EXPECT_EQ(frozen.size(), imap.size());
+    EXPECT_EQ(frozen.getValBegin(), 'A');
+    EXPECT_EQ(frozen.getMapSnippet(), imap.getMapSnippet());
+    for (int key = -3; key < 13; key++)
+    {
+        EXPECT_EQ(frozen[key], imap[key]) << key;
+    }
+
+    const frozen_interval_map<int, char> empty{interval_map<int, char>{'Z'}};
+    EXPECT_EQ(empty[0], 'Z');
+}
+
+TEST(testFrozenIntervalMap, lookupBatchMatchesOperator)
+{
+    std::mt19937 random{59};
+    interval_map<int, char> imap{'A'};
+    for (int step = 0; step < 300; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 5000);
+        imap.assign(keyBegin, keyBegin + static_cast<int>(random() % 40), static_cast<char>('A' + random() % 4));
+    }
+    const frozen_interval_map<int, char> frozen{imap};
+
+    // sizes that do not fill the last lookup group, plus keys outside the map
+    for (std::size_t count: {0u, 1u, 15u, 17u, 1000u})
+    {
+        std::vector<int> keys(count);
+        for (int &key: keys)
+        {
+            key = static_cast<int>(random() % 5200) - 100;
+        }
+        std::vector<char> fromFrozen(count, '?');
+        frozen.lookupBatch(keys.begin(), keys.end(), fromFrozen.data());
+        for (std::size_t i = 0; i < count; i++)
+        {
+            ASSERT_EQ(fromFrozen[i], imap[keys[i]]) << keys[i];
+        }
+    }
+}
+
+TEST(testFrozenIntervalMap, sharedReaderLookupBatch)
+{
+    interval_map<int, char> imap{'A'};
+    imap.assign(10, 20, 'B');
+    imap.assign(30, 40, 'C');
+    shared_interval_map_publisher<int, char> publisher{uniqueShmName("batch")};
+    publisher.publish(imap);
+    shared_interval_map_reader<int, char> reader{uniqueShmName("batch")};
+
+    const std::vector<int> keys{35, 9, 10, 19, 20, 45, 30, -5};
+    std::vector<char> values(keys.size());
+    reader.lookupBatch(keys.begin(), keys.end(), values.begin());
+    EXPECT_EQ(std::string(values.begin(), values.end()), "CABBAACA");
+    shared_interval_map_publisher<int, char>::remove(uniqueShmName("batch"));
+}
+
+TEST(testLearnedIntervalMap, matchesFrozenMapOnSkewedKeys)
+{
+    std::mt19937_64 random{60};
+    for (std::size_t maxError: {0u, 4u, 64u})
+    {
+        // dense runs separated by large jumps, so that the model needs many segments
+        std::vector<std::pair<std::uint64_t, int>> entries;
+        std::uint64_t key = 1000;
+        for (int i = 0; i < 5000; i++)
+        {
+            key += random() % 50 == 0 ? 1 + random() % (std::uint64_t(1) << 40) : 1 + random() % 8;
+            entries.emplace_back(key, i + 1);
+        }
+        const interval_map<std::uint64_t, int> imap{0, entries.begin(), entries.end()};
+        const learned_interval_map<std::uint64_t, int> learned{imap, maxError};
+        EXPECT_GT(learned.model().segmentCount(), 1u);
+        EXPECT_EQ(learned.size(), imap.size());
+
+        for (const auto &[boundary, value]: entries)
+        {
+            ASSERT_EQ(learned[boundary], value);
+            ASSERT_EQ(learned[boundary - 1], imap[boundary - 1]) << boundary;
+        }
+        for (int i = 0; i < 20000; i++)
+        {
+            const std::uint64_t query = random() % (key + 100);
+            ASSERT_EQ(learned[query], imap[query]) << query;
+        }
+        EXPECT_EQ(learned[0], 0);
+        EXPECT_EQ(learned[std::numeric_limits<std::uint64_t>::max()], entries.back().second);
+    }
+}
+
+TEST(testLearnedIntervalMap, signedAndFloatingPointKeys)
+{
+    interval_map<std::int64_t, char> imap{'A'};
+    imap.assign(std::numeric_limits<std::int64_t>::min() + 1, -5, 'B');
+    imap.assign(0, std::numeric_limits<std::int64_t>::max(), 'C');
+    const learned_interval_map<std::int64_t, char> learned{imap, 0};
+    for (const std::int64_t key: {std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::min() + 1,
+                                  std::int64_t(-6), std::int64_t(-5), std::int64_t(0), std::numeric_limits<std::int64_t>::max()})
+    {
+        EXPECT_EQ(learned[key], imap[key]) << key;
+    }
+
+    interval_map<double, char> dmap{'A'};
+    for (int i = 0; i < 100; i++)
+    {
+        dmap.assign(i * 0.5, i * 0.5 + 0.25, static_cast<char>('B' + i % 3));
+    }
+    const learned_interval_map<double, char> dlearned{dmap, 2};
+    for (double key = -1; key < 52; key += 0.125)
+    {
+        ASSERT_EQ(dlearned[key], dmap[key]) << key;
+    }
+
+    const learned_interval_map<int, char> empty{interval_map<int, char>{'Z'}};
+    EXPECT_EQ(empty[7], 'Z');
+}
+
+TEST(testPyramidIntervalMap, summarizesAlignedPixels)
+{
+    pyramid_interval_map<std::uint32_t, char> pyramid{'A'};
+    pyramid.assign(10, 20, 'B');
+    pyramid.assign(12, 13, 'C');
+    pyramid.assign(40, 60, 'D');
+
+    std::vector<pyramid_summary<std::uint32_t, char>> pixels;
+    pyramid.render(0, 64, 4, std::back_inserter(pixels));
+    ASSERT_EQ(pixels.size(), 4u);
+    // [0, 16): A x10, B, C, B x3
+    EXPECT_EQ(pixels[0].changes, 3u);
+    EXPECT_EQ(pixels[0].first, 'A');
+    EXPECT_EQ(pixels[0].last, 'B');
+    EXPECT_EQ(pixels[0].dominant, 'A');
+    EXPECT_EQ(pixels[1], (pyramid_summary<std::uint32_t, char>{'A', 12, 1, 'B', 'A'}));
+    EXPECT_EQ(pixels[2].changes, 1u);
+    EXPECT_EQ(pixels[2].dominant, 'A');
+    EXPECT_EQ(pixels[3], (pyramid_summary<std::uint32_t, char>{'D', 12, 1, 'D', 'A'}));
+
+    // far away from every boundary one bucket of the top level answers for the whole pixel
+    pixels.clear();
+    pyramid.render(1u << 28, 1u << 30, 3, std::back_inserter(pixels));
+    ASSERT_EQ(pixels.size(), 3u);
+    for (const auto &pixel: pixels)
+    {
+        EXPECT_EQ(pixel.dominant, 'A');
+        EXPECT_EQ(pixel.changes, 0u);
+    }
+}
+
+TEST(testPyramidIntervalMap, randomizedMatchesPerKeyScan)
+{
+    std::mt19937 random{61};
+    pyramid_interval_map<std::uint32_t, char> pyramid{'A'};
+    for (int step = 0; step < 400; step++)
+    {
+        const auto keyBegin = static_cast<std::uint32_t>(random() % 4096);
+        const auto keyEnd = static_cast<std::uint32_t>(keyBegin + random() % (step % 10 == 0 ? 2000 : 30));
+        pyramid.assign(keyBegin, keyEnd, static_cast<char>('A' + random() % 3));
+        if (step % 20 != 0)
+        {
+            continue;
+        }
+
+        // pixels of 256 keys are single buckets, so changes, first and last are exact
+        std::vector<pyramid_summary<std::uint32_t, char>> pixels;
+        pyramid.render(0, 8192, 32, std::back_inserter(pixels));
+        ASSERT_EQ(pixels.size(), 32u);
+        for (std::uint32_t pixel = 0; pixel < 32; pixel++)
+        {
+            const std::uint32_t pixelBegin = pixel * 256;
+            std::size_t changes = 0;
+            for (std::uint32_t key = pixelBegin + 1; key < pixelBegin + 256; key++)
+            {
+                changes += pyramid[key] == pyramid[key - 1] ? 0 : 1;
+            }
+            ASSERT_EQ(pixels[pixel].changes, changes) << pixel;
+            ASSERT_EQ(pixels[pixel].first, pyramid[pixelBegin]);
+            ASSERT_EQ(pixels[pixel].last, pyramid[pixelBegin + 255]);
+        }
+
+        // one key per pixel
+        pixels.clear();
+        pyramid.render(1000, 1100, 100, std::back_inserter(pixels));
+        for (std::uint32_t key = 1000; key < 1100; key++)
+        {
+            ASSERT_EQ(pixels[key - 1000], (pyramid_summary<std::uint32_t, char>::uniform(pyramid[key], 1)));
+        }
+
+        // maintaining the pyramid incrementally gives the same summaries as building it at once
+        const pyramid_interval_map<std::uint32_t, char> rebuilt{pyramid.base()};
+        for (unsigned level = 0; level < 8; level++)
+        {
+            for (std::uint32_t index = 0; index < (8192u >> (2 * level + 2)); index++)
+            {
+                ASSERT_EQ(pyramid.bucket(level, index), rebuilt.bucket(level, index)) << level << " " << index;
+            }
+        }
+        std::vector<pyramid_summary<std::uint32_t, char>> rebuiltPixels;
+        pixels.clear();
+        pyramid.render(3, 5000, 37, std::back_inserter(pixels));
+        rebuilt.render(3, 5000, 37, std::back_inserter(rebuiltPixels));
+        ASSERT_EQ(pixels, rebuiltPixels);
+    }
+}
+
+TEST(testRangeLockManager, grantsCompatibleLocks)
+{
+    range_lock_manager<int> locks;
+    locks.lock(0, 10, lock_mode::shared);
+    EXPECT_TRUE(locks.tryLock(5, 15, lock_mode::shared));
+    EXPECT_FALSE(locks.tryLock(9, 12, lock_mode::exclusive));
+    EXPECT_TRUE(locks.tryLock(15, 20, lock_mode::exclusive));
+    EXPECT_FALSE(locks.tryLock(19, 25, lock_mode::shared));
+
+    locks.unlock(0, 10, lock_mode::shared);
+    EXPECT_TRUE(locks.tryLock(0, 5, lock_mode::exclusive));
+    EXPECT_FALSE(locks.tryLock(4, 6, lock_mode::exclusive));
+    locks.unlock(0, 5, lock_mode::exclusive);
+    locks.unlock(5, 15, lock_mode::shared);
+    locks.unlock(15, 20, lock_mode::exclusive);
+    EXPECT_EQ(locks.size(), 0u);
+
+    {
+        auto scope = locks.scopedLock(0, 100, lock_mode::exclusive);
+        EXPECT_FALSE(locks.tryLock(50, 51, lock_mode::shared));
+    }
+    EXPECT_TRUE(locks.tryLock(50, 51, lock_mode::shared));
+}
+
+TEST(testRangeLockManager, exclusiveRangesNeverOverlap)
+{
+    constexpr int keyCount = 256;
+    range_lock_manager<int> locks;
+    std::vector<std::atomic<int>> writers(keyCount);
+    std::vector<std::atomic<int>> readers(keyCount);
+    std::atomic<bool> overlap{false};
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 8; thread++)
+    {
+        threads.emplace_back([&, thread]
+        {
+            std::mt19937 random{static_cast<unsigned>(64 + thread)};
+            for (int round = 0; round < 500; round++)
+            {
+                const int keyBegin = static_cast<int>(random() % keyCount);
+                const int keyEnd = std::min(keyCount, keyBegin + 1 + static_cast<int>(random() % 32));
+                const lock_mode mode = random() % 3 == 0 ? lock_mode::exclusive : lock_mode::shared;
+                auto scope = locks.scopedLock(keyBegin, keyEnd, mode);
+                for (int key = keyBegin; key < keyEnd; key++)
+                {
+                    if (mode == lock_mode::exclusive)
+                    {
+                        overlap = overlap || writers[key]++ != 0 || readers[key] != 0;
+                    }
+                    else
+                    {
+                        readers[key]++;
+                        overlap = overlap || writers[key] != 0;
+                    }
+                }
+                std::this_thread::yield();
+                for (int key = keyBegin; key < keyEnd; key++)
+                {
+                    (mode == lock_mode::exclusive ? writers : readers)[key]--;
+                }
+            }
+        });
+    }
+    for (auto &thread: threads)
+    {
+        thread.join();
+    }
+    EXPECT_FALSE(overlap);
+    EXPECT_EQ(locks.size(), 0u);
+}
+
+TEST(testAsyncIntervalMap, appliesInEnqueueOrder)
+{
+    std::mt19937 random{65};
+    interval_map<int, char> reference{'A'};
+    async_interval_map<int, char> async{'A', 16};
+    for (int step = 0; step < 2000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 1000);
+        const int keyEnd = keyBegin + static_cast<int>(random() % 50);
+        const char val = static_cast<char>('A' + random() % 4);
+        reference.assign(keyBegin, keyEnd, val);
+        async.asyncAssign(keyBegin, keyEnd, val);
+        if (step % 500 == 0)
+        {
+            async.flush();
+            ASSERT_EQ(async.read([](const interval_map<int, char> &map) { return map.getMapSnippet(); }), reference.getMapSnippet());
+        }
+    }
+
+    auto applied = async.barrier();
+    applied.wait();
+    EXPECT_EQ(async.read([](const interval_map<int, char> &map) { return map.getMapSnippet(); }), reference.getMapSnippet());
+    EXPECT_EQ(async[500], reference[500]);
+}
+
+TEST(testAsyncIntervalMap, producersOnSeveralThreads)
+{
+    async_interval_map<int, int> async{0, 8};
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < 4; producer++)
+    {
+        producers.emplace_back([&async, producer]
+        {
+            for (int key = 0; key < 500; key++)
+            {
+                async.asyncAssign(producer * 1000 + key, producer * 1000 + key + 1, producer + 1);
+            }
+            async.flush();
+            for (int key = 0; key < 500; key++)
+            {
+                ASSERT_EQ(async[producer * 1000 + key], producer + 1);
+            }
+        });
+    }
+    for (auto &producer: producers)
+    {
+        producer.join();
+    }
+    // every producer wrote one contiguous run
+    EXPECT_EQ(async.read([](const interval_map<int, int> &map) { return map.size(); }), 8u);
+}
+
+TEST(testAsyncIntervalMap, coalescedBatchesMatchSequentialAssigns)
+{
+    std::mt19937 random{65};
+    async_interval_map<int, char> async{'A', 4096};
+    interval_map<int, char> reference{'A'};
+    for (int round = 0; round < 5; round++)
+    {
+        // while the reader holds the map, the operations pile up into one batch
+        async.read([&](const interval_map<int, char> &)
+        {
+            for (int step = 0; step < 3000; step++)
+            {
+                const int keyBegin = static_cast<int>(random() % 300);
+                const int keyEnd = keyBegin + 1 + static_cast<int>(random() % (step % 2 ? 5 : 60));
+                const char val = static_cast<char>('A' + random() % 3);
+                async.asyncAssign(keyBegin, keyEnd, val);
+                reference.assign(keyBegin, keyEnd, val);
+            }
+            return 0;
+        });
+        async.flush();
+        ASSERT_EQ(async.read([](const interval_map<int, char> &map) { return map.getMapSnippet(); }), reference.getMapSnippet());
+    }
+}
+
+namespace
+{
+    // Value that can only be copied on threads that allow it, to make the applier thread fail.
+    struct thread_bound_value
+    {
+        static inline thread_local bool copyable = false;
+
+        explicit thread_bound_value(int id)
+            : id(id)
+        { }
+
+        thread_bound_value(const thread_bound_value &other)
+            : id(other.id)
+        {
+            if (!copyable && id < 0)
+            {
+                throw std::runtime_error("copy failed");
+            }
+        }
+
+        thread_bound_value &operator=(const thread_bound_value &) = default;
+
+        bool operator==(const thread_bound_value &other) const
+        {
+            return id == other.id;
+        }
+
+        int id;
+    };
+}
+
+TEST(testAsyncIntervalMap, failedAssignReachesWaiters)
+{
+    thread_bound_value::copyable = true;
+    async_interval_map<int, thread_bound_value> async{thread_bound_value{0}, 4};
+    async.asyncAssign(0, 10, thread_bound_value{1});
+    async.flush();
+
+    // the applier thread cannot copy the value into the map
+    async.asyncAssign(5, 6, thread_bound_value{-1});
+    auto failed = async.barrier();
+    EXPECT_THROW(failed.get(), std::runtime_error);
+    EXPECT_THROW(async.flush(), std::runtime_error);
+    EXPECT_THROW(async.barrier().get(), std::runtime_error);
+    EXPECT_THROW(async.asyncAssign(0, 1, thread_bound_value{2}), std::runtime_error);
+    EXPECT_EQ(async[3].id, 1);
+    thread_bound_value::copyable = false;
+}
+
+TEST(testParallelForEachSegment, matchesSequentialPass)
+{
+    std::mt19937 random{66};
+    interval_map<int, char> imap{'A'};
+    for (int step = 0; step < 3000; step++)
+    {
+        // clustered keys, so that the equally wide chunks hold very different numbers of segments
+        const int keyBegin = step % 4 ? static_cast<int>(random() % 1000) : static_cast<int>(random() % 1000000);
+        imap.assign(keyBegin, keyBegin + 1 + static_cast<int>(random() % 20), static_cast<char>('A' + random() % 4));
+    }
+
+    std::vector<std::tuple<int, int, char>> expected;
+    for (auto it = imap.begin(); it != imap.end(); ++it)
+    {
+        const auto next = std::next(it);
+        expected.emplace_back(it->first, next == imap.end() ? -1 : next->first, it->second);
+    }
+
+    for (std::size_t threads: {1u, 2u, 3u, 8u, 64u})
+    {
+        std::mutex mutex;
+        std::vector<std::tuple<int, int, char>> visited;
+        parallelForEachSegment(imap, [&](const int &segmentBegin, const int *segmentEnd, const char &value)
+        {
+            std::lock_guard<std::mutex> guard{mutex};
+            visited.emplace_back(segmentBegin, segmentEnd ? *segmentEnd : -1, value);
+        }, threads);
+        std::sort(visited.begin(), visited.end());
+        ASSERT_EQ(visited, expected) << threads;
+    }
+
+    int calls = 0;
+    parallelForEachSegment(interval_map<double, char>{'A'}, [&](const double &, const double *, const char &) { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(testParallelForEachSegment, rethrowsFirstException)
+{
+    interval_map<int, int> imap{0};
+    for (int key = 0; key < 1000; key++)
+    {
+        imap.assign(key, key + 1, key % 2 + 1);
+    }
+    std::atomic<int> calls{0};
+    EXPECT_THROW(parallelForEachSegment(imap, [&](const int &key, const int *, const int &)
+    {
+        calls++;
+        if (key == 500)
+        {
+            throw std::runtime_error("segment 500");
+        }
+    }, 4), std::runtime_error);
+    EXPECT_LE(calls.load(), 1001);
+}
+
+TEST(testAdaptiveIntervalMap, followsTheWorkload)
+{
+    adaptive_interval_map<int, int> map{0, 256};
+    EXPECT_EQ(map.backend(), adaptive_backend::tree);
+
+    // appending at the tail favours the flat layout
+    for (int key = 0; key < 5000; key++)
+    {
+        map.assign(key * 10, key * 10 + 5, key % 7 + 1);
+    }
+    EXPECT_EQ(map.backend(), adaptive_backend::flat);
+
+    // random assigns on a big map favour the tree
+    std::mt19937 random{69};
+    for (int step = 0; step < 2000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 50000);
+        map.assign(keyBegin, keyBegin + 3, step % 5);
+    }
+    EXPECT_EQ(map.backend(), adaptive_backend::tree);
+
+    // lookups alone never switch; adapt() between read phases moves to frozen,
+    // which the next assign leaves at once
+    const adaptive_interval_map<int, int> &reader = map;
+    long long sum = 0;
+    for (int round = 0; round < 4000; round++)
+    {
+        sum += reader[round * 13 % 50000];
+    }
+    EXPECT_EQ(map.backend(), adaptive_backend::tree);
+    for (int round = 0; round < 4000; round++)
+    {
+        sum += reader[round * 13 % 50000];
+        if (round % 256 == 255)
+        {
+            map.adapt();
+        }
+    }
+    EXPECT_EQ(map.backend(), adaptive_backend::frozen);
+    map.assign(7, 8, 9);
+    EXPECT_EQ(map.backend(), adaptive_backend::tree);
+    EXPECT_EQ(map[7], 9);
+    EXPECT_GT(sum, 0);
+}
+
+TEST(testAdaptiveIntervalMap, randomizedMatchesIntervalMap)
+{
+    std::mt19937 random{690};
+    adaptive_interval_map<int, char> map{'A', 64};
+    interval_map<int, char> reference{'A'};
+    for (int phase = 0; phase < 40; phase++)
+    {
+        // alternate read-mostly, append and random phases of varying length
+        const int kind = static_cast<int>(random() % 3);
+        const int length = 50 + static_cast<int>(random() % 400);
+        for (int step = 0; step < length; step++)
+        {
+            if (kind == 0 || random() % 4 == 0)
+            {
+                const int key = static_cast<int>(random() % 3000) - 100;
+                ASSERT_EQ(map[key], reference[key]) << key;
+                if (step % 64 == 0)
+                {
+                    map.adapt();
+                }
+                continue;
+            }
+            const int keyBegin = kind == 1 ? static_cast<int>(reference.size()) * 3 : static_cast<int>(random() % 3000);
+            const int keyEnd = keyBegin + 1 + static_cast<int>(random() % 20);
+            const char val = static_cast<char>('A' + random() % 4);
+            map.assign(keyBegin, keyEnd, val);
+            reference.assign(keyBegin, keyEnd, val);
+        }
+        ASSERT_EQ(map.getMapSnippet(), reference.getMapSnippet());
+        ASSERT_EQ(map.size(), reference.size());
+    }
+    // hysteresis keeps the number of switches well below the number of windows
+    EXPECT_LT(map.switchCount(), 40u);
+}
+
+namespace
+{
+    std::size_t allocationCount = 0;
+
+    // Stateless like std::allocator, so interval_map treats it the same way, but counts allocations.
+    template<typename T>
+    struct counting_allocator
+    {
+        using value_type = T;
+
+        counting_allocator() = default;
+
+        template<typename U>
+        counting_allocator(const counting_allocator<U> &)
+        { }
+
+        T *allocate(std::size_t count)
+        {
+            allocationCount++;
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T *pointer, std::size_t count)
+        {
+            std::allocator<T>().deallocate(pointer, count);
+        }
+
+        template<typename U>
+        bool operator==(const counting_allocator<U> &) const
+        {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const counting_allocator<U> &) const
+        {
+            return false;
+        }
+    };
+}
+
+TEST(testIntervalMap, defaultAllocatorReusesMovedNodes)
+{
+    interval_map<int, int> map{0};
+    map.assign(0, 10, 1);
+    map.assign(20, 30, 1);
+    // the boundary at 30 moves to 35 in its own node
+    const auto *node = &*map.lowerBound(30);
+    map.assign(5, 35, 3);
+    EXPECT_EQ(&*map.lowerBound(35), node);
+    EXPECT_EQ(map.getMapSnippet(), "[0, 1][5, 3][35, 0]");
+}
+
+TEST(testIntervalMap, statelessAllocatorAllocatesOnlyNewBoundaries)
+{
+    interval_map<int, int, std::equal_to<int>, counting_allocator<std::pair<const int, int>>> map{0};
+    map.assign(0, 10, 1);
+    map.assign(20, 30, 1);
+    // boundaries 0, 10, 20 and 30; the ones at 20 and 30 move to 5 and 35
+    allocationCount = 0;
+    map.assign(5, 35, 3);
+    EXPECT_EQ(allocationCount, 0u);
+    EXPECT_EQ(map.getMapSnippet(), "[0, 1][5, 3][35, 0]");
+
+    // a range inside one segment needs new nodes at both ends
+    allocationCount = 0;
+    map.assign(10, 20, 5);
+    EXPECT_EQ(allocationCount, 2u);
+    EXPECT_EQ(map.getMapSnippet(), "[0, 1][5, 3][10, 5][20, 3][35, 0]");
+
+    std::mt19937 random{70};
+    allocationCount = 0;
+    for (int step = 0; step < 10000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 100000);
+        map.assign(keyBegin, keyBegin + 1 + static_cast<int>(random() % 200), static_cast<int>(random() % 8));
+    }
+    // without reuse every moved boundary costs a node, about four times as many allocations
+    EXPECT_LT(allocationCount, 10000u);
+}
+
+TEST(testCompact, arenaNodesInKeyOrderAfterChurn)
+{
+    std::mt19937 random{700};
+    using arena_map = interval_map<int, int, std::equal_to<int>, node_arena_allocator<std::pair<const int, int>>>;
+    arena_map map{0, node_arena_allocator<std::pair<const int, int>>(64)};
+    interval_map<int, int> reference{0};
+    for (int step = 0; step < 20000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 100000);
+        const int keyEnd = keyBegin + 1 + static_cast<int>(random() % 50);
+        const int val = static_cast<int>(random() % 8);
+        map.assign(keyBegin, keyEnd, val);
+        reference.assign(keyBegin, keyEnd, val);
+    }
+    const layout_stats before = map.layout();
+    EXPECT_EQ(before.entries, map.size());
+    EXPECT_LT(before.sequentialFraction(), 0.5);
+
+    map.compact();
+    const layout_stats after = map.layout();
+    EXPECT_EQ(after.entries, before.entries);
+    EXPECT_EQ(after.sequential, after.entries - 1);
+    EXPECT_LT(after.meanDistance, before.meanDistance);
+    EXPECT_EQ(map.getMapSnippet(), reference.getMapSnippet());
+
+    // the compacted map keeps working, and a copy gets an arena of its own
+    arena_map copy = map;
+    const std::string snippet = map.getMapSnippet();
+    map.assign(10, 20000, 9);
+    reference.assign(10, 20000, 9);
+    EXPECT_EQ(map.getMapSnippet(), reference.getMapSnippet());
+    EXPECT_EQ(copy.getMapSnippet(), snippet);
+    copy.compact();
+    EXPECT_EQ(copy.getMapSnippet(), snippet);
+    EXPECT_EQ(copy.layout().sequential, copy.size() - 1);
+}
+
+TEST(testCompact, defaultAllocatorKeepsContents)
+{
+    interval_map<int, std::string> map{"A"};
+    map.assign(1, 3, "B");
+    map.assign(5, 9, "C");
+    map.assign(2, 6, "D");
+    const std::string snippet = map.getMapSnippet();
+    map.compact();
+    EXPECT_EQ(map.getMapSnippet(), snippet);
+    EXPECT_EQ(map.layout().entries, map.size());
+
+    interval_map<int, std::string> empty{"A"};
+    empty.compact();
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT_EQ(empty.layout().sequentialFraction(), 1);
+}
+
+TEST(testTolerantIntervalMap, noisySamplesMerge)
+{
+    std::mt19937 random{710};
+    std::uniform_real_distribution<double> noise{-0.05, 0.05};
+    interval_map<int, double, absolute_tolerance<double>> tolerant{0.0, absolute_tolerance<double>{0.1}};
+    interval_map<int, double> exact{0.0};
+    for (int key = 0; key < 10000; key++)
+    {
+        // a new level every 100 samples
+        const double sample = 1.0 + key / 100 + noise(random);
+        tolerant.assign(key, key + 1, sample);
+        exact.assign(key, key + 1, sample);
+    }
+    EXPECT_EQ(exact.size(), 10001u);
+    EXPECT_LE(tolerant.size(), 101u);
+    for (int key = 0; key < 10000; key++)
+    {
+        ASSERT_LE(std::abs(tolerant[key] - exact[key]), 0.1) << key;
+    }
+}
+
+TEST(testTolerantIntervalMap, bulkAssignsCompareExactly)
+{
+    interval_map<int, double, absolute_tolerance<double>> tolerant{0.0, absolute_tolerance<double>{0.1}};
+    tolerant.assign(0, 10, 1.0);
+    tolerant.assign(10, 20, 1.05);
+    EXPECT_EQ(tolerant.getMapSnippet(), "[0, 1][20, 0]");
+    {
+        auto bulk = tolerant.beginBulk();
+        tolerant.assign(20, 30, 1.05);
+        tolerant.assign(30, 40, 1.05);
+    }
+    // merged by operator== only, not snapped to 1
+    EXPECT_EQ(tolerant.getMapSnippet(), "[0, 1][20, 1.05][40, 0]");
+    EXPECT_EQ(tolerant[25], 1.05);
+}
+
+TEST(testTolerantIntervalMap, errorDoesNotAccumulate)
+{
+    std::mt19937 random{711};
+    const double epsilon = 0.5;
+    interval_map<int, double, absolute_tolerance<double>> tolerant{0.0, absolute_tolerance<double>{epsilon}};
+    interval_map<int, double> exact{0.0};
+    for (int step = 0; step < 5000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 200);
+        const int keyEnd = keyBegin + 1 + static_cast<int>(random() % 40);
+        // small steps, so that many assigns snap to a neighbour
+        const double val = exact[keyBegin] + (static_cast<int>(random() % 7) - 3) * 0.3;
+        tolerant.assign(keyBegin, keyEnd, val);
+        exact.assign(keyBegin, keyEnd, val);
+        if (step % 50 == 0)
+        {
+            for (int key = -1; key < 245; key++)
+            {
+                ASSERT_LE(std::abs(tolerant[key] - exact[key]), epsilon) << step << " " << key;
+            }
+        }
+    }
+    // canonical with respect to operator==
+    double previous = tolerant.getValBegin();
+    for (const auto &[key, value]: tolerant)
+    {
+        EXPECT_NE(value, previous) << key;
+        previous = value;
+    }
+    EXPECT_LT(tolerant.size(), exact.size());
+}
+
+TEST(testStringIntervalMap, matchesStdStringValues)
+{
+    std::mt19937 random{720};
+    const std::string labels[] = {"", "short", "a label longer than the small string buffer", "another fairly long label text"};
+    string_interval_map<int> map{labels[0]};
+    interval_map<int, std::string> reference{labels[0]};
+    for (int step = 0; step < 3000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 500);
+        const int keyEnd = keyBegin + 1 + static_cast<int>(random() % 30);
+        // a fresh copy each time, the map must not keep a pointer to the argument
+        const std::string label = labels[random() % 4];
+        map.assign(keyBegin, keyEnd, label);
+        reference.assign(keyBegin, keyEnd, label);
+    }
+    EXPECT_EQ(map.getMapSnippet(), reference.getMapSnippet());
+    EXPECT_EQ(map.size(), reference.size());
+    for (int key = -1; key < 531; key++)
+    {
+        ASSERT_EQ(map[key], reference[key]) << key;
+    }
+    EXPECT_EQ(map.pool().size(), 4u);
+}
+
+TEST(testStringIntervalMap, internsEachLabelOnce)
+{
+    string_pool pool;
+    const pooled_string first = pool.intern("label");
+    const pooled_string second = pool.intern(std::string("lab") + "el");
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.view().data(), second.view().data());
+    EXPECT_NE(first, pool.intern("other"));
+    const std::string longText(10000, 'x');
+    EXPECT_EQ(pool.intern(longText).view(), longText);
+    EXPECT_EQ(first.view(), "label");
+    EXPECT_EQ(pool.size(), 3u);
+
+    // views stay valid when the map is moved
+    string_interval_map<int> map{"A"};
+    map.assign(1, 3, "B");
+    string_interval_map<int> moved = std::move(map);
+    EXPECT_EQ(moved[2], "B");
+    EXPECT_EQ(moved.getValBegin(), "A");
+    EXPECT_EQ(moved.getMapSnippet(), "[1, B][3, A]");
+}
+
+// Value that counts its copies and comparisons.
+struct counted_value
+{
+    static inline int copies = 0;
+    static inline int comparisons = 0;
+
+    explicit counted_value(int id)
+        : id(id)
+    { }
+
+    counted_value(const counted_value &other)
+        : id(other.id)
+    {
+        copies++;
+    }
+
+    counted_value &operator=(const counted_value &other)
+    {
+        id = other.id;
+        copies++;
+        return *this;
+    }
+
+    bool operator==(const counted_value &other) const
+    {
+        comparisons++;
+        return id == other.id;
+    }
+
+    int id;
+};
+
+static std::ostream &operator<<(std::ostream &stream, const counted_value &value)
+{
+    return stream << value.id;
+}
+
+TEST(testSharedValue, assignMovesHandlesOnly)
+{
+    const shared_value<counted_value> zero{std::in_place, 0};
+    const shared_value<counted_value> one{std::in_place, 1};
+    const shared_value<counted_value> two{std::in_place, 2};
+    const shared_value<counted_value> otherOne{std::in_place, 1};
+    counted_value::copies = counted_value::comparisons = 0;
+
+    interval_map<int, shared_value<counted_value>> map{zero};
+    std::mt19937 random{730};
+    for (int step = 0; step < 1000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 100);
+        map.assign(keyBegin, keyBegin + 1 + static_cast<int>(random() % 10), random() % 2 ? one : two);
+    }
+    EXPECT_EQ(counted_value::copies, 0);
+    // only handles to different blocks reach counted_value::operator==
+    EXPECT_GT(counted_value::comparisons, 0);
+    map.assign(0, 200, one);
+    const int comparisons = counted_value::comparisons;
+    map.assign(50, 60, one);
+    EXPECT_EQ(counted_value::comparisons, comparisons);
+
+    // equal values in different blocks still merge
+    map.assign(60, 70, otherOne);
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.getMapSnippet(), "[0, 1][200, 0]");
+    EXPECT_TRUE(map[65].sameBlock(one));
+    EXPECT_EQ(map[300]->id, 0);
+    EXPECT_EQ(counted_value::copies, 0);
+}
+
+namespace
+{
+    enum class char_class { other, digit, letter, space };
+
+    constexpr auto charClasses = []
+    {
+        constexpr_interval_map<char, char_class, 10> map{char_class::other};
+        map.assign('a', 'z' + 1, char_class::letter);
+        map.assign('A', 'Z' + 1, char_class::letter);
+        map.assign('0', '9' + 1, char_class::digit);
+        map.assign('\t', '\r' + 1, char_class::space);
+        map.assign(' ', ' ' + 1, char_class::space);
+        // merges with the neighbouring letters again
+        map.assign('m', 'p', char_class::letter);
+        return map;
+    }();
+
+    static_assert(charClasses['q'] == char_class::letter);
+    static_assert(charClasses['Q'] == char_class::letter);
+    static_assert(charClasses['7'] == char_class::digit);
+    static_assert(charClasses['\n'] == char_class::space);
+    static_assert(charClasses['_'] == char_class::other);
+    static_assert(charClasses.size() == 10);
+}
+
+TEST(testConstexprIntervalMap, matchesIntervalMap)
+{
+    EXPECT_EQ(charClasses[' '], char_class::space);
+    EXPECT_EQ(charClasses['{'], char_class::other);
+
+    std::mt19937 random{740};
+    constexpr_interval_map<int, char, 64> map{'A'};
+    interval_map<int, char> reference{'A'};
+    for (int step = 0; step < 5000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 100);
+        const int keyEnd = keyBegin + static_cast<int>(random() % 12);
+        const char val = static_cast<char>('A' + random() % 4);
+        reference.assign(keyBegin, keyEnd, val);
+        if (reference.size() > 64)
+        {
+            EXPECT_THROW(map.assign(keyBegin, keyEnd, val), std::length_error);
+            reference.assign(0, 100, 'A');
+            map.assign(0, 100, 'A');
+            continue;
+        }
+        map.assign(keyBegin, keyEnd, val);
+        ASSERT_EQ(map.getMapSnippet(), reference.getMapSnippet()) << step;
+    }
+    for (int key = -1; key < 113; key++)
+    {
+        ASSERT_EQ(map[key], reference[key]) << key;
+    }
+}
+
+TEST(testFixedIntervalMap, matchesIntervalMapAndReportsOverflow)
+{
+    std::mt19937 random{750};
+    fixed_interval_map<int, char, 16> map{'A'};
+    interval_map<int, char> reference{'A'};
+    int rejected = 0;
+    for (int step = 0; step < 20000; step++)
+    {
+        const int keyBegin = static_cast<int>(random() % 100);
+        const int keyEnd = keyBegin + static_cast<int>(random() % 12);
+        const char val = static_cast<char>('A' + random() % 4);
+        const std::string before = map.getMapSnippet();
+        interval_map<int, char> next = reference;
+        next.assign(keyBegin, keyEnd, val);
+        const bool fits = next.size() <= 16;
+        ASSERT_EQ(map.assign(keyBegin, keyEnd, val), fits) << step;
+        if (fits)
+        {
+            reference = next;
+        }
+        else
+        {
+            // a rejected assign leaves the map untouched
+            ASSERT_EQ(map.getMapSnippet(), before);
+            rejected++;
+        }
+        ASSERT_EQ(map.getMapSnippet(), reference.getMapSnippet()) << step;
+    }
+    EXPECT_GT(rejected, 0);
+    for (int key = -1; key < 113; key++)
+    {
+        ASSERT_EQ(map[key], reference[key]) << key;
+    }
+    EXPECT_TRUE(map.assign(5, 5, 'Z'));
+}
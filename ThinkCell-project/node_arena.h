@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+
+namespace detail
+{
+    /*
+        Bump allocator over a list of blocks. Objects are carved from the current block in the
+        order they are requested, so containers that allocate one node per element in key order
+        end up with their nodes side by side. Freed objects go to a free list per size and are
+        handed out again before the block grows; memory is only returned when the arena dies.
+
+        The first block holds expectedObjects objects of the first requested size, later blocks
+        double in size. Not thread-safe.
+    */
+    class node_arena
+    {
+    public:
+        explicit node_arena(std::size_t expectedObjects)
+            : m_expectedObjects(std::max<std::size_t>(expectedObjects, 16))
+        { }
+
+        node_arena(const node_arena &) = delete;
+        node_arena &operator=(const node_arena &) = delete;
+
+        void *allocate(std::size_t bytes, std::size_t alignment)
+        {
+            if (alignment > alignof(std::max_align_t))
+            {
+                throw std::bad_alloc();
+            }
+            bytes = roundUp(bytes, alignof(std::max_align_t));
+            if (free_list *list = freeList(bytes); list && list->head)
+            {
+                void *result = list->head;
+                list->head = *static_cast<void **>(result);
+                return result;
+            }
+            if (m_current == nullptr || static_cast<std::size_t>(m_end - m_current) < bytes)
+            {
+                const std::size_t blockSize = m_blocks.empty()
+                    ? m_expectedObjects * bytes
+                    : std::max(2 * m_lastBlockSize, bytes);
+                m_blocks.push_back(std::make_unique<std::max_align_t[]>(roundUp(blockSize, sizeof(std::max_align_t)) / sizeof(std::max_align_t)));
+                m_lastBlockSize = blockSize;
+                m_current = reinterpret_cast<std::byte *>(m_blocks.back().get());
+                m_end = m_current + blockSize;
+            }
+            void *result = m_current;
+            m_current += bytes;
+            return result;
+        }
+
+        void deallocate(void *pointer, std::size_t bytes)
+        {
+            bytes = roundUp(bytes, alignof(std::max_align_t));
+            free_list *list = freeList(bytes);
+            if (list == nullptr)
+            {
+                list = &m_freeLists.emplace_back();
+                list->bytes = bytes;
+            }
+            *static_cast<void **>(pointer) = list->head;
+            list->head = pointer;
+        }
+
+    private:
+        struct free_list
+        {
+            std::size_t bytes = 0;
+            void *head = nullptr;
+        };
+
+        static std::size_t roundUp(std::size_t bytes, std::size_t alignment)
+        {
+            return (std::max(bytes, sizeof(void *)) + alignment - 1) / alignment * alignment;
+        }
+
+        // containers allocate objects of one or two sizes, a linear search is fine
+        free_list *freeList(std::size_t bytes)
+        {
+            for (free_list &list: m_freeLists)
+            {
+                if (list.bytes == bytes)
+                {
+                    return &list;
+                }
+            }
+            return nullptr;
+        }
+
+        const std::size_t m_expectedObjects;
+        std::vector<std::unique_ptr<std::max_align_t[]>> m_blocks;
+        std::size_t m_lastBlockSize = 0;
+        std::byte *m_current = nullptr;
+        std::byte *m_end = nullptr;
+        std::vector<free_list> m_freeLists;
+    };
+}
+
+
+/*
+    Allocator drawing from a detail::node_arena shared by all its copies and rebinds; the arena is
+    released together with the last of them. A container using it keeps its nodes in few blocks
+    instead of spread over the heap, and interval_map::compact() rebuilds the map into a new arena
+    (see fresh()) so that the nodes are laid out in key order again.
+
+    Copying a container gives the copy its own arena, and moving or swapping containers moves the
+    arena along with the nodes, so containers never share an arena and may be used from different
+    threads like ones with std::allocator.
+*/
+template<typename T>
+class node_arena_allocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    explicit node_arena_allocator(std::size_t expectedObjects = 1024)
+        : m_arena(std::make_shared<detail::node_arena>(expectedObjects))
+    { }
+
+    template<typename U>
+    node_arena_allocator(const node_arena_allocator<U> &other) noexcept
+        : m_arena(other.m_arena)
+    { }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t count)
+    {
+        m_arena->deallocate(pointer, count * sizeof(T));
+    }
+
+    // Allocator with a new, empty arena whose first block fits expectedObjects objects.
+    node_arena_allocator fresh(std::size_t expectedObjects) const
+    {
+        return node_arena_allocator(expectedObjects);
+    }
+
+    node_arena_allocator select_on_container_copy_construction() const
+    {
+        return node_arena_allocator();
+    }
+
+    template<typename U>
+    bool operator==(const node_arena_allocator<U> &other) const
+    {
+        return m_arena == other.m_arena;
+    }
+
+    template<typename U>
+    bool operator!=(const node_arena_allocator<U> &other) const
+    {
+        return m_arena != other.m_arena;
+    }
+
+private:
+    template<typename U>
+    friend class node_arena_allocator;
+
+    std::shared_ptr<detail::node_arena> m_arena;
+};
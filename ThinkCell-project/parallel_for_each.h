@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "interval_map.h"
+#include "work_stealing.h"
+
+
+/*
+    Calls fn(segmentBegin, segmentEnd, value) for every boundary (segmentBegin, value) of map, on
+    threadCount threads. segmentEnd points to the key of the next boundary, or is null for the last
+    boundary, whose segment is unbounded; the keys before the first boundary hold
+    map.getValBegin() and are not visited.
+
+    The key range from the first to the last boundary is cut into 16 chunks per thread of equal key
+    width, each found with one O(log N) search, and the chunks run on a work-stealing pool so that
+    unevenly filled chunks even out. The end of a chunk's last segment is read from the boundary
+    that starts the next chunk, so segment ends are the same as in a sequential pass. Calls for
+    different segments may run concurrently and in any order; the map must not change meanwhile.
+*/
+template<typename K, typename V, typename Fn>
+void parallelForEachSegment(const interval_map<K, V> &map, Fn fn,
+                            std::size_t threadCount = std::thread::hardware_concurrency())
+{
+    static_assert(std::is_arithmetic_v<K>, "parallelForEachSegment needs arithmetic keys to split the range");
+    if (map.empty())
+    {
+        return;
+    }
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    const K &firstKey = map.begin()->first;
+    const K &lastKey = std::prev(map.end())->first;
+    const std::size_t chunkCount = std::min(threadCount * 16, map.size());
+    // chunk i covers the boundaries [starts[i], starts[i + 1])
+    std::vector<decltype(map.begin())> starts(chunkCount + 1, map.end());
+    starts[0] = map.begin();
+    for (std::size_t chunk = 1; chunk < chunkCount; chunk++)
+    {
+        starts[chunk] = map.lowerBound(detail::bucketStart(firstKey, lastKey, chunk, chunkCount));
+    }
+
+    detail::runWorkStealing(chunkCount, threadCount, [&](std::size_t chunk)
+    {
+        for (auto it = starts[chunk]; it != starts[chunk + 1]; )
+        {
+            const auto &[key, value] = *it;
+            ++it;
+            fn(key, it == map.end() ? nullptr : &it->first, value);
+        }
+    });
+}
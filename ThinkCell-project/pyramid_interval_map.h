@@ -0,0 +1,277 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "interval_map.h"
+
+
+// Summary of the values of a run of consecutive keys, as kept per bucket by pyramid_interval_map.
+template<typename K, typename V>
+struct pyramid_summary
+{
+    V dominant;
+    // keys holding dominant; exact on level 0, a lower bound once buckets of different values are merged
+    K coverage;
+    // number of keys in the run whose value differs from the value of the key before them
+    std::size_t changes;
+    V first;
+    V last;
+
+    static pyramid_summary uniform(const V &value, const K &keys)
+    {
+        return {value, keys, 0, value, value};
+    }
+
+    // Summary of the runs *runs[0], ..., *runs[count - 1], which follow each other without gaps.
+    // The dominant value is the one with the largest total coverage among the runs' own dominants.
+    static pyramid_summary merge(const pyramid_summary *const *runs, std::size_t count)
+    {
+        pyramid_summary result = *runs[0];
+        for (std::size_t i = 1; i < count; i++)
+        {
+            result.changes += runs[i]->changes + (runs[i]->first == result.last ? 0 : 1);
+            result.last = runs[i]->last;
+        }
+        for (std::size_t candidate = 0; candidate < count; candidate++)
+        {
+            K coverage = 0;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (runs[i]->dominant == runs[candidate]->dominant)
+                {
+                    // saturates, pixels spanning most of a 64-bit key range may add up to more than K holds
+                    coverage = runs[i]->coverage < std::numeric_limits<K>::max() - coverage ? static_cast<K>(coverage + runs[i]->coverage)
+                                                                                          : std::numeric_limits<K>::max();
+                }
+            }
+            if (candidate == 0 || result.coverage < coverage)
+            {
+                result.dominant = runs[candidate]->dominant;
+                result.coverage = coverage;
+            }
+        }
+        return result;
+    }
+
+    bool operator==(const pyramid_summary &other) const
+    {
+        return dominant == other.dominant && coverage == other.coverage && changes == other.changes
+               && first == other.first && last == other.last;
+    }
+};
+
+
+/*
+    interval_map for unsigned integer keys that also keeps a pyramid of downsampled summaries,
+    for rendering the map at any zoom level.
+
+    Level i splits the key space into aligned buckets of 2^((i + 1) * Step) keys and stores a
+    pyramid_summary per bucket in an interval_map keyed by bucket index, so runs of buckets lying
+    inside one segment share a single entry and every level holds O(N) entries. assign() sets the
+    buckets it covers completely to a uniform summary and recomputes the at most two partly covered
+    buckets per level from their 2^Step children one level down, which costs
+    O(levels * 2^Step * log N).
+
+    render() summarizes each output pixel from the coarsest level whose buckets still fit into the
+    pixel, i.e. from at most 2^Step + 1 buckets, in O(width * 2^Step * log N) regardless of the
+    size of the key range. Buckets that straddle a pixel edge count towards that pixel as a whole,
+    so summaries are exact for pixels aligned to a level and approximate otherwise.
+*/
+template<typename K, typename V, unsigned Step = 2>
+class pyramid_interval_map
+{
+    static_assert(std::is_integral_v<K> && std::is_unsigned_v<K>, "pyramid_interval_map needs unsigned integer keys");
+    static_assert(Step > 0 && Step < std::numeric_limits<K>::digits, "Step must be smaller than the key width");
+
+public:
+    using summary_type = pyramid_summary<K, V>;
+
+    explicit pyramid_interval_map(const V &value)
+        : m_base(value)
+    {
+        for (unsigned level = 0; level < levelCount; level++)
+        {
+            m_levels.emplace_back(summary_type::uniform(value, bucketWidth(level)));
+        }
+    }
+
+    // Builds the pyramid of an existing map in O(N * levels * 2^Step * log N).
+    explicit pyramid_interval_map(const interval_map<K, V> &map)
+        : pyramid_interval_map(map.getValBegin())
+    {
+        m_base = map;
+        for (auto it = map.begin(); it != map.end(); )
+        {
+            const auto &[key, value] = *it;
+            ++it;
+            update(key, it == map.end() ? std::numeric_limits<K>::max() : static_cast<K>(it->first - 1), value);
+        }
+    }
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        m_base.assign(keyBegin, keyEnd, val);
+        update(keyBegin, static_cast<K>(keyEnd - 1), val);
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return m_base[key];
+    }
+
+    const interval_map<K, V> &base() const
+    {
+        return m_base;
+    }
+
+    static constexpr unsigned levels()
+    {
+        return levelCount;
+    }
+
+    // Summary of the bucket with the given index on level, i.e. of the keys
+    // [index * 2^((level + 1) * Step), (index + 1) * 2^((level + 1) * Step)).
+    const summary_type &bucket(unsigned level, const K &index) const
+    {
+        return m_levels[level][index];
+    }
+
+    // Splits [keyBegin, keyEnd) into width pixels of (almost) equal size and writes a summary_type
+    // for each of them. A pixel narrower than one key, which happens when the range has fewer keys
+    // than width, summarizes the key it starts at.
+    template<typename OutputIt>
+    OutputIt render(const K &keyBegin, const K &keyEnd, std::size_t width, OutputIt out) const
+    {
+        if (!(keyBegin < keyEnd) || width == 0)
+        {
+            return out;
+        }
+        const K span = static_cast<K>(keyEnd - keyBegin);
+        const K quotient = static_cast<K>(span / width);
+        const K remainder = static_cast<K>(span % width);
+        K pixelBegin = keyBegin;
+        for (std::size_t pixel = 1; pixel <= width; pixel++)
+        {
+            // keyBegin + span * pixel / width without overflowing K
+            const K pixelEnd = static_cast<K>(keyBegin + quotient * pixel + static_cast<unsigned long long>(remainder) * pixel / width);
+            *out++ = summarize(pixelBegin, pixelEnd);
+            pixelBegin = pixelEnd;
+        }
+        return out;
+    }
+
+private:
+    static constexpr unsigned levelCount = (std::numeric_limits<K>::digits - 1) / Step;
+    static constexpr K childCount = K(1) << Step;
+
+    static constexpr unsigned shift(unsigned level)
+    {
+        return (level + 1) * Step;
+    }
+
+    static constexpr K bucketWidth(unsigned level)
+    {
+        return K(1) << shift(level);
+    }
+
+    // Brings every level up to date after [first, last] was assigned val in m_base.
+    void update(const K &first, const K &last, const V &val)
+    {
+        for (unsigned level = 0; level < levelCount; level++)
+        {
+            const K mask = static_cast<K>(bucketWidth(level) - 1);
+            const K firstBucket = first >> shift(level);
+            const K lastBucket = last >> shift(level);
+            const bool firstPartial = (first & mask) != 0;
+            const bool lastPartial = (last & mask) != mask;
+
+            // bucket indices are below 2^(digits - Step), so lastBucket + 1 cannot overflow
+            const K coveredBegin = firstPartial ? static_cast<K>(firstBucket + 1) : firstBucket;
+            const K coveredEnd = lastPartial ? lastBucket : static_cast<K>(lastBucket + 1);
+            m_levels[level].assign(coveredBegin, coveredEnd, summary_type::uniform(val, bucketWidth(level)));
+
+            if (firstPartial)
+            {
+                recompute(level, firstBucket);
+            }
+            if (lastPartial && (lastBucket != firstBucket || !firstPartial))
+            {
+                recompute(level, lastBucket);
+            }
+        }
+    }
+
+    void recompute(unsigned level, const K &index)
+    {
+        const K firstChild = static_cast<K>(index << Step);
+        if (level == 0)
+        {
+            m_levels[0].assign(index, static_cast<K>(index + 1), summarizeKeys(firstChild, static_cast<K>(firstChild + childCount)));
+            return;
+        }
+        std::array<const summary_type *, childCount> children{};
+        for (K i = 0; i < childCount; i++)
+        {
+            children[i] = &m_levels[level - 1][static_cast<K>(firstChild + i)];
+        }
+        m_levels[level].assign(index, static_cast<K>(index + 1), summary_type::merge(children.data(), childCount));
+    }
+
+    // Summary of the fewer than 2^Step + 1 keys [keyBegin, keyEnd), straight from m_base.
+    summary_type summarizeKeys(const K &keyBegin, const K &keyEnd) const
+    {
+        std::array<std::optional<summary_type>, childCount> keys;
+        std::array<const summary_type *, childCount> runs{};
+        std::size_t count = 0;
+        for (K key = keyBegin; key != keyEnd; key++, count++)
+        {
+            runs[count] = &keys[count].emplace(summary_type::uniform(m_base[key], 1));
+        }
+        return summary_type::merge(runs.data(), count);
+    }
+
+    summary_type summarize(const K &keyBegin, const K &keyEnd) const
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return summary_type::uniform(m_base[keyBegin], 0);
+        }
+        const K length = static_cast<K>(keyEnd - keyBegin);
+        if (length < bucketWidth(0))
+        {
+            return summarizeKeys(keyBegin, keyEnd);
+        }
+
+        unsigned level = 0;
+        while (level + 1 < levelCount && bucketWidth(level + 1) <= length)
+        {
+            level++;
+        }
+        // length < 2^Step buckets, so the pixel touches at most 2^Step + 1 of them
+        std::array<const summary_type *, childCount + 1> buckets{};
+        std::size_t count = 0;
+        const K lastBucket = static_cast<K>(keyEnd - 1) >> shift(level);
+        for (K index = keyBegin >> shift(level); ; index++)
+        {
+            buckets[count++] = &m_levels[level][index];
+            if (index == lastBucket)
+            {
+                break;
+            }
+        }
+        return summary_type::merge(buckets.data(), count);
+    }
+
+    interval_map<K, V> m_base;
+    std::vector<interval_map<K, summary_type>> m_levels;
+};
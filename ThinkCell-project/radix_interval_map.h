@@ -0,0 +1,245 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+#include "interval_map.h"
+
+
+/*
+    interval_map for unsigned integer keys organised like a page table.
+
+    Each node splits its key range into 2^Bits equally sized slots, and every slot either holds a
+    single value for its whole range or points to a child node one level down. A key is resolved by
+    following its Bits-wide digits from the top, so a lookup takes at most digits(K) / Bits steps no
+    matter how many boundaries there are, and a large uniform range costs a single slot high up.
+
+    assign() splits slots that are only partly covered into child nodes and afterwards collapses
+    every child whose slots all hold the same value, so the tree stays minimal. The intervals it
+    represents are reported canonically by forEachBoundary() and getMapSnippet().
+
+    Nodes are reference counted and never modified while shared, so copying a map is O(1): an
+    assign() on either copy clones only the nodes on its path that the other copy still uses.
+    Copies may be used from different threads; a single instance may not.
+*/
+template<typename K, typename V, unsigned Bits = 8>
+class radix_interval_map
+{
+    static_assert(std::is_integral_v<K> && std::is_unsigned_v<K>, "radix_interval_map needs unsigned integer keys");
+    static_assert(Bits > 0 && std::numeric_limits<K>::digits % Bits == 0, "key width must be a multiple of Bits");
+
+public:
+    explicit radix_interval_map(const V &value)
+        : m_valBegin(value)
+        , m_root(std::in_place_index<1>, value)
+    { }
+
+    radix_interval_map(const radix_interval_map &) = default;
+    radix_interval_map &operator=(const radix_interval_map &) = default;
+    radix_interval_map(radix_interval_map &&) = default;
+    radix_interval_map &operator=(radix_interval_map &&) = default;
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        assignSlot(m_root, 0, keyDigits, keyBegin, static_cast<K>(keyEnd - 1), val);
+    }
+
+    const V &operator[](const K &key) const
+    {
+        const slot *current = &m_root;
+        unsigned shift = keyDigits;
+        while (const auto *child = std::get_if<node_ptr>(current))
+        {
+            shift -= Bits;
+            current = &(*child)->slots[(key >> shift) & slotMask];
+        }
+        return std::get<V>(*current);
+    }
+
+    const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    // Number of nodes in this map, each holding 2^Bits slots; nodes shared with copies count as well.
+    std::size_t nodeCount() const
+    {
+        return m_nodeCount;
+    }
+
+    // Calls fn(key, value) for every boundary the canonical interval_map<K, V> would hold.
+    template<typename Fn>
+    void forEachBoundary(Fn fn) const
+    {
+        const V *current = &m_valBegin;
+        auto onSlot = [&](const K &key, const V &value)
+        {
+            if (!(value == *current))
+            {
+                fn(key, value);
+                current = &value;
+            }
+        };
+        visit(m_root, 0, keyDigits, onSlot);
+    }
+
+    // Same output as interval_map<K, V>::getMapSnippet.
+    std::string getMapSnippet() const
+    {
+        std::string result;
+        auto out = std::back_inserter(result);
+        forEachBoundary([&out](const K &key, const V &value)
+        {
+            out = detail::writeBoundary(out, key, value);
+        });
+        return result;
+    }
+
+private:
+    static constexpr unsigned keyDigits = std::numeric_limits<K>::digits;
+    static constexpr std::size_t slotCount = std::size_t(1) << Bits;
+    static constexpr K slotMask = static_cast<K>(slotCount - 1);
+
+    struct node;
+    using node_ptr = std::shared_ptr<node>;
+    // a child node or one value for the whole range; the null child only exists while splitting
+    using slot = std::variant<node_ptr, V>;
+
+    struct node
+    {
+        std::array<slot, slotCount> slots;
+    };
+
+    // Last key of the range starting at base that spans 2^digits keys.
+    static K rangeLast(const K &base, unsigned digits)
+    {
+        return digits >= keyDigits ? std::numeric_limits<K>::max() : static_cast<K>(base | ((K(1) << digits) - 1));
+    }
+
+    // The node of target, cloned first if another map still uses it.
+    static node &writableNode(slot &target)
+    {
+        auto &child = std::get<node_ptr>(target);
+        if (child.use_count() > 1)
+        {
+            child = std::make_shared<node>(*child);
+        }
+        else
+        {
+            // pairs with the release decrement of the copies that let go of the node
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *child;
+    }
+
+    void setValue(slot &target, const V &val)
+    {
+        if (auto *child = std::get_if<node_ptr>(&target))
+        {
+            m_nodeCount -= countNodes(**child);
+            target.template emplace<1>(val);
+        }
+        else
+        {
+            std::get<V>(target) = val;
+        }
+    }
+
+    static std::size_t countNodes(const node &subtree)
+    {
+        std::size_t result = 1;
+        for (const auto &child: subtree.slots)
+        {
+            if (const auto *grandChild = std::get_if<node_ptr>(&child))
+            {
+                result += countNodes(**grandChild);
+            }
+        }
+        return result;
+    }
+
+    // target covers the 2^digits keys from base on; [first, last] intersects that range.
+    void assignSlot(slot &target, const K &base, unsigned digits, const K &first, const K &last, const V &val)
+    {
+        const K targetLast = rangeLast(base, digits);
+        if (first <= base && targetLast <= last)
+        {
+            setValue(target, val);
+            return;
+        }
+
+        if (auto *value = std::get_if<V>(&target))
+        {
+            if (*value == val)
+            {
+                return;
+            }
+            // split the uniform slot into a node
+            auto split = std::make_shared<node>();
+            for (auto &child: split->slots)
+            {
+                child.template emplace<1>(*value);
+            }
+            target.template emplace<0>(std::move(split));
+            m_nodeCount++;
+        }
+
+        auto &children = writableNode(target).slots;
+        const unsigned childDigits = digits - Bits;
+        const std::size_t firstChild = first < base ? 0 : static_cast<std::size_t>((first - base) >> childDigits);
+        const std::size_t lastChild = targetLast < last ? slotCount - 1 : static_cast<std::size_t>((last - base) >> childDigits);
+        for (std::size_t i = firstChild; i <= lastChild; i++)
+        {
+            const K childBase = static_cast<K>(base + (static_cast<K>(i) << childDigits));
+            assignSlot(children[i], childBase, childDigits, first, last, val);
+        }
+
+        // collapse the node if all its slots ended up with the same value
+        V *uniform = std::get_if<V>(&children[0]);
+        for (std::size_t i = 1; uniform && i < slotCount; i++)
+        {
+            const V *value = std::get_if<V>(&children[i]);
+            if (!value || !(*value == *uniform))
+            {
+                uniform = nullptr;
+            }
+        }
+        if (uniform)
+        {
+            V collapsed = std::move(*uniform);
+            target.template emplace<1>(std::move(collapsed));
+            m_nodeCount--;
+        }
+    }
+
+    template<typename Fn>
+    static void visit(const slot &current, const K &base, unsigned digits, Fn &fn)
+    {
+        if (const auto *value = std::get_if<V>(&current))
+        {
+            fn(base, *value);
+            return;
+        }
+        const auto &children = std::get<node_ptr>(current)->slots;
+        const unsigned childDigits = digits - Bits;
+        for (std::size_t i = 0; i < slotCount; i++)
+        {
+            visit(children[i], static_cast<K>(base + (static_cast<K>(i) << childDigits)), childDigits, fn);
+        }
+    }
+
+    V m_valBegin;
+    slot m_root;
+    std::size_t m_nodeCount = 0;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "interval_map.h"
+
+
+enum class lock_mode
+{
+    shared,
+    exclusive
+};
+
+
+/*
+    Shared and exclusive locks on key ranges [keyBegin, keyEnd).
+
+    The holders of every key are tracked in an interval_map<K, holders>, so the state costs one
+    entry per boundary between differently locked ranges no matter how wide the ranges are, and
+    ranges released by everyone merge back into the unlocked background. A request is granted when
+    no key of its range is locked exclusively and, for an exclusive request, not locked shared
+    either; otherwise the thread blocks on a condition variable until a release changes the state.
+
+    Requests for disjoint ranges never wait for each other, but all of them go through one mutex
+    for the O(log N + segments in range) bookkeeping. There is no fairness between waiters: a
+    stream of overlapping shared locks can keep an exclusive request waiting.
+*/
+template<typename K>
+class range_lock_manager
+{
+public:
+    range_lock_manager()
+        : m_holders(holders{})
+    { }
+
+    range_lock_manager(const range_lock_manager &) = delete;
+    range_lock_manager &operator=(const range_lock_manager &) = delete;
+
+    // Blocks until [keyBegin, keyEnd) can be locked in mode, then locks it. Empty ranges lock nothing.
+    void lock(const K &keyBegin, const K &keyEnd, lock_mode mode)
+    {
+        std::unique_lock<std::mutex> guard{m_mutex};
+        m_released.wait(guard, [&] { return available(keyBegin, keyEnd, mode); });
+        change(keyBegin, keyEnd, mode, true);
+    }
+
+    // Locks [keyBegin, keyEnd) in mode if that is possible without waiting.
+    bool tryLock(const K &keyBegin, const K &keyEnd, lock_mode mode)
+    {
+        std::lock_guard<std::mutex> guard{m_mutex};
+        if (!available(keyBegin, keyEnd, mode))
+        {
+            return false;
+        }
+        change(keyBegin, keyEnd, mode, true);
+        return true;
+    }
+
+    // Releases a lock taken by lock() or tryLock() with the same range and mode.
+    void unlock(const K &keyBegin, const K &keyEnd, lock_mode mode)
+    {
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            change(keyBegin, keyEnd, mode, false);
+        }
+        m_released.notify_all();
+    }
+
+    // Scope of a lock, see scopedLock().
+    class lock_scope
+    {
+    public:
+        lock_scope(const lock_scope &) = delete;
+        lock_scope &operator=(const lock_scope &) = delete;
+
+        ~lock_scope()
+        {
+            m_manager.unlock(m_keyBegin, m_keyEnd, m_mode);
+        }
+
+    private:
+        friend class range_lock_manager;
+
+        lock_scope(range_lock_manager &manager, const K &keyBegin, const K &keyEnd, lock_mode mode)
+            : m_manager(manager)
+            , m_keyBegin(keyBegin)
+            , m_keyEnd(keyEnd)
+            , m_mode(mode)
+        {
+            m_manager.lock(m_keyBegin, m_keyEnd, m_mode);
+        }
+
+        range_lock_manager &m_manager;
+        K m_keyBegin;
+        K m_keyEnd;
+        lock_mode m_mode;
+    };
+
+    // lock() that is undone by unlock() when the returned scope ends.
+    [[nodiscard]] lock_scope scopedLock(const K &keyBegin, const K &keyEnd, lock_mode mode)
+    {
+        return lock_scope(*this, keyBegin, keyEnd, mode);
+    }
+
+    // Number of boundaries between differently locked ranges, i.e. the size of the bookkeeping.
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> guard{m_mutex};
+        return m_holders.size();
+    }
+
+private:
+    struct holders
+    {
+        std::size_t shared = 0;
+        bool exclusive = false;
+
+        bool operator==(const holders &other) const
+        {
+            return shared == other.shared && exclusive == other.exclusive;
+        }
+    };
+
+    bool available(const K &keyBegin, const K &keyEnd, lock_mode mode) const
+    {
+        bool result = true;
+        m_holders.forEachSegment(keyBegin, keyEnd, [&](const K &, const K &, const holders &current)
+        {
+            result = result && !current.exclusive && (mode == lock_mode::shared || current.shared == 0);
+        });
+        return result;
+    }
+
+    // Adds a holder of mode to every key of [keyBegin, keyEnd), or removes one.
+    void change(const K &keyBegin, const K &keyEnd, lock_mode mode, bool acquire)
+    {
+        // collect first, assign() invalidates the segments being visited
+        m_segments.clear();
+        m_holders.forEachSegment(keyBegin, keyEnd, [&](const K &segmentBegin, const K &segmentEnd, const holders &current)
+        {
+            m_segments.emplace_back(segmentBegin, segmentEnd, current);
+        });
+        for (auto &[segmentBegin, segmentEnd, current]: m_segments)
+        {
+            if (mode == lock_mode::shared)
+            {
+                current.shared = acquire ? current.shared + 1 : current.shared - 1;
+            }
+            else
+            {
+                current.exclusive = acquire;
+            }
+            m_holders.assign(segmentBegin, segmentEnd, current);
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_released;
+    interval_map<K, holders> m_holders;
+    std::vector<std::tuple<K, K, holders>> m_segments;
+};
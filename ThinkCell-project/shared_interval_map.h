@@ -0,0 +1,406 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch_search.h"
+#include "interval_map.h"
+
+
+/*
+    Publication of a frozen interval_map into POSIX shared memory.
+
+    The publisher works through a small control segment `name` holding an atomic generation
+    counter. Every publish() writes the whole map into a fresh data segment `name.<generation>`
+    and only then bumps the counter, so readers never see a half-written layout. The previous
+    data segment is unlinked right away; readers that still have it mapped keep using it until
+    they refresh().
+
+    The control segment outlives the publisher: its destructor only marks it closed, so readers
+    learn on their next refresh() that the publisher is gone, and a restarted publisher continues
+    the same counter, which attached readers pick up again. remove() deletes it for good.
+
+    The data segment is position independent: a header followed by the sorted keys and the
+    values, addressed by offsets from the segment start. values[0] is m_valBegin and values[i + 1]
+    belongs to keys[i], so a lookup is a single upper_bound over the keys.
+    K and V are copied bytewise and therefore have to be trivially copyable.
+*/
+
+namespace detail
+{
+    constexpr std::uint64_t shmControlMagic = 0x4C52544E43504D49ULL; // "IMPCNTRL"
+    constexpr std::uint64_t shmLayoutMagic = 0x54554F59414C4D49ULL;  // "IMLAYOUT"
+
+    struct shm_control
+    {
+        std::uint64_t magic;
+        std::atomic<std::uint64_t> generation;
+        // nonzero from the destruction of a publisher until the next one starts
+        std::atomic<std::uint64_t> closed;
+    };
+
+    struct shm_layout_header
+    {
+        std::uint64_t magic;
+        std::uint64_t generation;
+        std::uint64_t keySize;
+        std::uint64_t valueSize;
+        std::uint64_t count;
+        std::uint64_t keysOffset;
+        std::uint64_t valuesOffset;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                  "the generation counter is shared between processes and must not use a lock");
+
+    constexpr std::uint64_t alignOffset(std::uint64_t offset, std::uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    inline std::string shmDataName(const std::string &name, std::uint64_t generation)
+    {
+        return name + "." + std::to_string(generation);
+    }
+
+    // Owns one mmap()ed POSIX shared-memory object.
+    class shm_mapping
+    {
+    public:
+        shm_mapping() = default;
+
+        shm_mapping(const shm_mapping &) = delete;
+        shm_mapping &operator=(const shm_mapping &) = delete;
+
+        shm_mapping(shm_mapping &&other) noexcept
+            : m_data(std::exchange(other.m_data, nullptr))
+            , m_size(std::exchange(other.m_size, 0))
+        { }
+
+        shm_mapping &operator=(shm_mapping &&other) noexcept
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            return *this;
+        }
+
+        ~shm_mapping()
+        {
+            if (m_data)
+            {
+                ::munmap(m_data, m_size);
+            }
+        }
+
+        // Opens (creating if needed) name for writing and sizes it to size bytes.
+        static shm_mapping create(const std::string &name, std::size_t size)
+        {
+            const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            }
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+            }
+            return map(fd, size, PROT_READ | PROT_WRITE, name);
+        }
+
+        // Maps an existing name; returns an empty mapping if it does not exist (any more).
+        static shm_mapping open(const std::string &name, bool writable)
+        {
+            const int fd = ::shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+            if (fd < 0)
+            {
+                if (errno == ENOENT)
+                {
+                    return {};
+                }
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            }
+            struct stat info;
+            if (::fstat(fd, &info) != 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "fstat " + name);
+            }
+            return map(fd, static_cast<std::size_t>(info.st_size), writable ? PROT_READ | PROT_WRITE : PROT_READ, name);
+        }
+
+        explicit operator bool() const
+        {
+            return m_data != nullptr;
+        }
+
+        void *data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+    private:
+        static shm_mapping map(int fd, std::size_t size, int protection, const std::string &name)
+        {
+            void *data = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+            const int error = errno;
+            ::close(fd);
+            if (data == MAP_FAILED)
+            {
+                throw std::system_error(error, std::generic_category(), "mmap " + name);
+            }
+            shm_mapping result;
+            result.m_data = data;
+            result.m_size = size;
+            return result;
+        }
+
+        void *m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+}
+
+
+template<typename K, typename V>
+class shared_interval_map_publisher
+{
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "shared memory layout copies keys and values bytewise");
+
+public:
+    // name follows shm_open() rules, e.g. "/permissions".
+    explicit shared_interval_map_publisher(std::string name)
+        : m_name(std::move(name))
+        , m_control(detail::shm_mapping::create(m_name, sizeof(detail::shm_control)))
+    {
+        auto *control = static_cast<detail::shm_control *>(m_control.data());
+        if (control->magic != detail::shmControlMagic)
+        {
+            // fresh segment (zero filled); continue the counter of an earlier publisher otherwise
+            new (control) detail::shm_control{detail::shmControlMagic, {0}, {0}};
+        }
+        m_generation = control->generation.load(std::memory_order_acquire);
+        control->closed.store(0, std::memory_order_release);
+    }
+
+    shared_interval_map_publisher(const shared_interval_map_publisher &) = delete;
+    shared_interval_map_publisher &operator=(const shared_interval_map_publisher &) = delete;
+
+    // Marks the control segment closed before unlinking the current version.
+    ~shared_interval_map_publisher()
+    {
+        static_cast<detail::shm_control *>(m_control.data())->closed.store(1, std::memory_order_release);
+        if (m_generation != 0)
+        {
+            ::shm_unlink(detail::shmDataName(m_name, m_generation).c_str());
+        }
+    }
+
+    // Closes and unlinks the control segment of name once no publisher uses it any more.
+    static void remove(const std::string &name)
+    {
+        if (auto control = detail::shm_mapping::open(name, true); control && control.size() >= sizeof(detail::shm_control))
+        {
+            static_cast<detail::shm_control *>(control.data())->closed.store(1, std::memory_order_release);
+        }
+        ::shm_unlink(name.c_str());
+    }
+
+    // Writes a frozen copy of map and makes it the current version; returns its generation.
+    std::uint64_t publish(const interval_map<K, V> &map)
+    {
+        const std::uint64_t generation = m_generation + 1;
+        const std::uint64_t count = map.size();
+        const std::uint64_t keysOffset = detail::alignOffset(sizeof(detail::shm_layout_header), alignof(K));
+        const std::uint64_t valuesOffset = detail::alignOffset(keysOffset + count * sizeof(K), alignof(V));
+        const std::uint64_t size = valuesOffset + (count + 1) * sizeof(V);
+
+        {
+            const std::string dataName = detail::shmDataName(m_name, generation);
+            ::shm_unlink(dataName.c_str()); // left over by a crashed publisher
+            auto data = detail::shm_mapping::create(dataName, size);
+            auto *base = static_cast<unsigned char *>(data.data());
+
+            K *keys = reinterpret_cast<K *>(base + keysOffset);
+            V *values = reinterpret_cast<V *>(base + valuesOffset);
+            std::memcpy(values, &map.getValBegin(), sizeof(V));
+            for (const auto &[key, value]: map)
+            {
+                std::memcpy(keys++, &key, sizeof(K));
+                std::memcpy(++values, &value, sizeof(V));
+            }
+
+            const detail::shm_layout_header header{detail::shmLayoutMagic, generation, sizeof(K), sizeof(V),
+                                                   count, keysOffset, valuesOffset};
+            std::memcpy(base, &header, sizeof(header));
+        }
+
+        auto *control = static_cast<detail::shm_control *>(m_control.data());
+        control->generation.store(generation, std::memory_order_release);
+
+        if (m_generation != 0)
+        {
+            ::shm_unlink(detail::shmDataName(m_name, m_generation).c_str());
+        }
+        m_generation = generation;
+        return generation;
+    }
+
+    std::uint64_t generation() const
+    {
+        return m_generation;
+    }
+
+private:
+    std::string m_name;
+    detail::shm_mapping m_control;
+    std::uint64_t m_generation = 0;
+};
+
+
+template<typename K, typename V>
+class shared_interval_map_reader
+{
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "shared memory layout copies keys and values bytewise");
+
+public:
+    // Attaches to the current version published under name; throws if nothing was published yet.
+    explicit shared_interval_map_reader(std::string name)
+        : m_name(std::move(name))
+        , m_control(detail::shm_mapping::open(m_name, false))
+    {
+        if (!m_control || m_control.size() < sizeof(detail::shm_control)
+            || static_cast<const detail::shm_control *>(m_control.data())->magic != detail::shmControlMagic)
+        {
+            throw std::runtime_error("no interval_map published as " + m_name);
+        }
+        if (!refresh())
+        {
+            throw std::runtime_error("no interval_map published as " + m_name);
+        }
+    }
+
+    // Switches to the newest published version; returns true if the version changed.
+    // Lookups keep using the attached version until then, also after refresh() threw. Throws if
+    // the publisher is gone, and if the data segment is malformed.
+    bool refresh()
+    {
+        const auto *control = static_cast<const detail::shm_control *>(m_control.data());
+        if (control->closed.load(std::memory_order_acquire) != 0)
+        {
+            throw std::runtime_error("publisher of " + m_name + " is gone");
+        }
+        std::uint64_t generation = control->generation.load(std::memory_order_acquire);
+        for (;;)
+        {
+            if (generation == m_generation)
+            {
+                return false;
+            }
+
+            auto data = detail::shm_mapping::open(detail::shmDataName(m_name, generation), false);
+            if (!data)
+            {
+                // publish() bumps the counter before it unlinks the previous version, so a missing
+                // segment with an unchanged counter was unlinked by the publisher's destructor,
+                // which may not have marked the control segment closed yet
+                const std::uint64_t current = control->generation.load(std::memory_order_acquire);
+                if (current == generation)
+                {
+                    throw std::runtime_error("publisher of " + m_name + " is gone");
+                }
+                generation = current;
+                continue;
+            }
+
+            const auto *base = static_cast<const unsigned char *>(data.data());
+            detail::shm_layout_header header;
+            if (data.size() < sizeof(header))
+            {
+                throw std::runtime_error("incompatible interval_map layout in " + m_name);
+            }
+            std::memcpy(&header, base, sizeof(header));
+            if (header.magic != detail::shmLayoutMagic || header.generation != generation
+                || header.keySize != sizeof(K) || header.valueSize != sizeof(V))
+            {
+                throw std::runtime_error("incompatible interval_map layout in " + m_name);
+            }
+            // the first check bounds count by the segment size, so count + 1 cannot overflow
+            if (!fitsArray(header.keysOffset, header.count, sizeof(K), alignof(K), data.size())
+                || !fitsArray(header.valuesOffset, header.count + 1, sizeof(V), alignof(V), data.size()))
+            {
+                throw std::runtime_error("corrupt interval_map layout in " + m_name);
+            }
+
+            m_keys = reinterpret_cast<const K *>(base + header.keysOffset);
+            m_values = reinterpret_cast<const V *>(base + header.valuesOffset);
+            m_count = header.count;
+            m_data = std::move(data);
+            m_generation = generation;
+            return true;
+        }
+    }
+
+    std::uint64_t generation() const
+    {
+        return m_generation;
+    }
+
+    std::size_t size() const
+    {
+        return m_count;
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return m_values[std::upper_bound(m_keys, m_keys + m_count, key) - m_keys];
+    }
+
+    // Same as frozen_interval_map::lookupBatch, against the snapshot of the last refresh().
+    template<typename KeyIt, typename OutIt>
+    void lookupBatch(KeyIt first, KeyIt last, OutIt out) const
+    {
+        detail::batchUpperBound(m_keys, m_count, first, last, [&](std::size_t index, std::size_t position)
+        {
+            out[index] = m_values[position];
+        });
+    }
+
+private:
+    // Whether count aligned elements of elementSize bytes at offset lie behind the header and
+    // within size bytes.
+    static bool fitsArray(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t alignment, std::uint64_t size)
+    {
+        return offset >= sizeof(detail::shm_layout_header) && offset <= size && offset % alignment == 0
+            && count <= (size - offset) / elementSize;
+    }
+
+    std::string m_name;
+    detail::shm_mapping m_control;
+    detail::shm_mapping m_data;
+    std::uint64_t m_generation = 0;
+    const K *m_keys = nullptr;
+    const V *m_values = nullptr;
+    std::size_t m_count = 0;
+};
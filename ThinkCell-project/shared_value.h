@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <utility>
+
+
+/*
+    Immutable, reference-counted value for interval_map<K, shared_value<V>> when V is expensive
+    to copy or compare. The map then copies and destroys handles, which costs a reference count
+    update, instead of V, and comparing two handles of the same block skips V's operator==.
+    Handles to different blocks holding equal values still compare equal, so the map stays
+    canonical in terms of V.
+
+    Build the handle once and pass it to every assign() of the same value, then the value is
+    neither copied nor compared. The reference counts are atomic as for any std::shared_ptr,
+    which is the price for handles crossing threads safely.
+*/
+template<typename V>
+class shared_value
+{
+public:
+    explicit shared_value(V value)
+        : m_value(std::make_shared<const V>(std::move(value)))
+    { }
+
+    template<typename... Args>
+    explicit shared_value(std::in_place_t, Args &&...args)
+        : m_value(std::make_shared<const V>(std::forward<Args>(args)...))
+    { }
+
+    const V &get() const
+    {
+        return *m_value;
+    }
+
+    const V &operator*() const
+    {
+        return *m_value;
+    }
+
+    const V *operator->() const
+    {
+        return m_value.get();
+    }
+
+    // Whether both handles share one block.
+    bool sameBlock(const shared_value &other) const
+    {
+        return m_value == other.m_value;
+    }
+
+    bool operator==(const shared_value &other) const
+    {
+        return m_value == other.m_value || *m_value == *other.m_value;
+    }
+
+    bool operator!=(const shared_value &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    std::shared_ptr<const V> m_value;
+};
+
+template<typename V>
+std::ostream &operator<<(std::ostream &stream, const shared_value<V> &value)
+{
+    return stream << *value;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "inline_boundaries.h"
+#include "interval_map.h"
+
+
+/*
+    interval_map with the same semantics that keeps up to N boundaries inline, without any heap
+    allocation, and searches them linearly. The first assign that would need more than N boundaries
+    moves everything into a regular interval_map, which is used from then on.
+
+    Meant for huge numbers of maps that are almost always tiny: small_interval_map<int, char>
+    takes no allocation at all until it grows beyond N boundaries.
+*/
+template<typename K, typename V, std::size_t N = 8>
+class small_interval_map
+{
+public:
+    explicit small_interval_map(const V &value)
+        : m_valBegin(value)
+    { }
+
+    small_interval_map(const small_interval_map &other)
+        : m_valBegin(other.m_valBegin)
+        , m_inline(other.m_inline)
+        , m_tree(other.m_tree ? std::make_unique<interval_map<K, V>>(*other.m_tree) : nullptr)
+    { }
+
+    small_interval_map &operator=(const small_interval_map &other)
+    {
+        if (this != &other)
+        {
+            small_interval_map copy{other};
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    small_interval_map(small_interval_map &&) = default;
+    small_interval_map &operator=(small_interval_map &&) = default;
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, const V &val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        if (m_tree)
+        {
+            m_tree->assign(keyBegin, keyEnd, val);
+            return;
+        }
+
+        const auto plan = m_inline.planAssign(keyBegin, keyEnd, val, m_valBegin);
+        if (plan.newSize <= N)
+        {
+            m_inline.applyAssign(plan, keyBegin, keyEnd, val, m_valBegin);
+        }
+        else
+        {
+            promote();
+            m_tree->assign(keyBegin, keyEnd, val);
+        }
+    }
+
+    const V &operator[](const K &key) const
+    {
+        return m_tree ? (*m_tree)[key] : m_inline.lookup(key, m_valBegin);
+    }
+
+    // True while the boundaries still live in the inline storage.
+    bool isInline() const
+    {
+        return !m_tree;
+    }
+
+    std::size_t size() const
+    {
+        return m_tree ? m_tree->size() : m_inline.size();
+    }
+
+    const V &getValBegin() const
+    {
+        return m_valBegin;
+    }
+
+    std::string getMapSnippet() const
+    {
+        if (m_tree)
+        {
+            return m_tree->getMapSnippet();
+        }
+
+        std::string result;
+        auto out = std::back_inserter(result);
+        for (std::size_t i = 0; i < m_inline.size(); i++)
+        {
+            out = detail::writeBoundary(out, m_inline.key(i), m_inline.value(i));
+        }
+        return result;
+    }
+
+private:
+    void promote()
+    {
+        std::vector<std::pair<K, V>> boundaries;
+        boundaries.reserve(m_inline.size());
+        for (std::size_t i = 0; i < m_inline.size(); i++)
+        {
+            boundaries.emplace_back(m_inline.key(i), m_inline.value(i));
+        }
+        m_tree = std::make_unique<interval_map<K, V>>(m_valBegin, boundaries.begin(), boundaries.end());
+        m_inline.clear();
+    }
+
+    V m_valBegin;
+    detail::inline_boundaries<K, V, N> m_inline;
+    std::unique_ptr<interval_map<K, V>> m_tree;
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "interval_map.h"
+
+
+/*
+    Handle to a string interned in a string_pool: one pointer, compared by address. Two handles
+    from the same pool are equal exactly if their strings are; handles from different pools must
+    not be compared.
+*/
+class pooled_string
+{
+public:
+    std::string_view view() const
+    {
+        return *m_entry;
+    }
+
+    bool operator==(const pooled_string &other) const
+    {
+        return m_entry == other.m_entry;
+    }
+
+    bool operator!=(const pooled_string &other) const
+    {
+        return m_entry != other.m_entry;
+    }
+
+private:
+    friend class string_pool;
+
+    explicit pooled_string(const std::string_view *entry)
+        : m_entry(entry)
+    { }
+
+    const std::string_view *m_entry;
+};
+
+inline std::ostream &operator<<(std::ostream &stream, const pooled_string &string)
+{
+    return stream << string.view();
+}
+
+
+/*
+    Stores every distinct string once. The characters are appended to blocks that never move and
+    the views onto them live in an unordered_set, whose elements keep their address on rehash, so
+    handles stay valid as long as the pool. Strings are never removed; the pool is meant for a
+    bounded set of labels, not for arbitrary text.
+*/
+class string_pool
+{
+public:
+    string_pool() = default;
+    string_pool(const string_pool &) = delete;
+    string_pool &operator=(const string_pool &) = delete;
+
+    // Handle of text, adding a copy of it to the pool if it is not there yet.
+    pooled_string intern(std::string_view text)
+    {
+        auto it = m_entries.find(text);
+        if (it == m_entries.end())
+        {
+            it = m_entries.insert(store(text)).first;
+        }
+        return pooled_string(&*it);
+    }
+
+    // Number of distinct strings.
+    std::size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    // Bytes held by the character blocks.
+    std::size_t capacityBytes() const
+    {
+        return m_capacityBytes;
+    }
+
+private:
+    static constexpr std::size_t blockSize = 4096;
+
+    std::string_view store(std::string_view text)
+    {
+        if (text.empty())
+        {
+            return std::string_view();
+        }
+        if (text.size() > static_cast<std::size_t>(m_end - m_current))
+        {
+            // long strings get a block of their own so that the current block is not wasted
+            const std::size_t size = std::max(text.size(), blockSize);
+            auto block = std::make_unique<char[]>(size);
+            char *data = block.get();
+            m_capacityBytes += size;
+            if (size > blockSize)
+            {
+                m_blocks.insert(m_blocks.begin(), std::move(block));
+                std::memcpy(data, text.data(), text.size());
+                return std::string_view(data, text.size());
+            }
+            m_blocks.push_back(std::move(block));
+            m_current = data;
+            m_end = data + size;
+        }
+        std::memcpy(m_current, text.data(), text.size());
+        std::string_view result(m_current, text.size());
+        m_current += text.size();
+        return result;
+    }
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    std::size_t m_capacityBytes = 0;
+    char *m_current = nullptr;
+    char *m_end = nullptr;
+    std::unordered_set<std::string_view> m_entries;
+};
+
+
+/*
+    interval_map from K to strings that keeps each distinct string once in a string_pool owned by
+    the map and stores an 8 byte pooled_string per boundary. assign() hashes the label to find it
+    in the pool instead of copying it into the node, and the merges of assign() compare pointers
+    instead of characters. Lookups return views into the pool, valid as long as the map.
+
+    Labels assigned once stay in the pool even after no key maps to them anymore, so this suits
+    maps with a limited vocabulary of labels.
+*/
+template<typename K>
+class string_interval_map
+{
+public:
+    explicit string_interval_map(std::string_view value)
+        : m_pool(std::make_unique<string_pool>())
+        , m_map(m_pool->intern(value))
+    { }
+
+    // Same contract as interval_map::assign.
+    void assign(const K &keyBegin, const K &keyEnd, std::string_view val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+        m_map.assign(keyBegin, keyEnd, m_pool->intern(val));
+    }
+
+    std::string_view operator[](const K &key) const
+    {
+        return m_map[key].view();
+    }
+
+    std::string_view getValBegin() const
+    {
+        return m_map.getValBegin().view();
+    }
+
+    std::size_t size() const
+    {
+        return m_map.size();
+    }
+
+    std::string getMapSnippet() const
+    {
+        return m_map.getMapSnippet();
+    }
+
+    // The boundaries, for anything not forwarded here.
+    const interval_map<K, pooled_string> &map() const
+    {
+        return m_map;
+    }
+
+    const string_pool &pool() const
+    {
+        return *m_pool;
+    }
+
+private:
+    // behind a pointer so that moving the map leaves the handles in m_map valid
+    std::unique_ptr<string_pool> m_pool;
+    interval_map<K, pooled_string> m_map;
+};
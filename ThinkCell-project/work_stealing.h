@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace detail
+{
+    // Task indices owned by one worker: it takes from the back, thieves from the front.
+    class task_deque
+    {
+    public:
+        void push(std::size_t task)
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            m_tasks.push_back(task);
+        }
+
+        bool pop(std::size_t &task)
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            if (m_tasks.empty())
+            {
+                return false;
+            }
+            task = m_tasks.back();
+            m_tasks.pop_back();
+            return true;
+        }
+
+        bool steal(std::size_t &task)
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            if (m_tasks.empty())
+            {
+                return false;
+            }
+            task = m_tasks.front();
+            m_tasks.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::deque<std::size_t> m_tasks;
+    };
+
+    /*
+        Calls fn(task) for every task in [0, taskCount) on threadCount threads, the calling thread
+        being one of them. Every worker starts with a contiguous block of tasks and, once its own
+        deque is empty, steals the oldest task of another worker, so a few expensive tasks do not
+        leave the other threads idle. Tasks cannot add tasks, hence a worker is done as soon as it
+        finds every deque empty.
+
+        The first exception thrown by fn is rethrown after all workers have stopped; the remaining
+        tasks are skipped.
+    */
+    template<typename Fn>
+    void runWorkStealing(std::size_t taskCount, std::size_t threadCount, Fn fn)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+        if (threadCount > taskCount)
+        {
+            threadCount = taskCount == 0 ? 1 : taskCount;
+        }
+
+        std::vector<task_deque> deques(threadCount);
+        for (std::size_t task = 0; task < taskCount; task++)
+        {
+            deques[task * threadCount / taskCount].push(task);
+        }
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        auto work = [&](std::size_t worker)
+        {
+            std::size_t task;
+            for (;;)
+            {
+                bool found = deques[worker].pop(task);
+                for (std::size_t other = 1; !found && other < threadCount; other++)
+                {
+                    found = deques[(worker + other) % threadCount].steal(task);
+                }
+                if (!found)
+                {
+                    return;
+                }
+                try
+                {
+                    fn(task);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard{errorMutex};
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    // drop everything still queued so that all workers stop soon
+                    for (auto &deque: deques)
+                    {
+                        while (deque.pop(task))
+                        { }
+                    }
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t worker = 1; worker < threadCount; worker++)
+        {
+            threads.emplace_back(work, worker);
+        }
+        work(0);
+        for (auto &thread: threads)
+        {
+            thread.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}